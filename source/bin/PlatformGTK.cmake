@@ -49,6 +49,10 @@ if (HAVE_LIBSSL)
     list(APPEND xguipro_LIBRARIES ${OPENSSL_LIBRARIES})
 endif (HAVE_LIBSSL)
 
+if (HAVE_ZLIB)
+    list(APPEND xguipro_LIBRARIES ${ZLIB_LIBRARIES})
+endif (HAVE_ZLIB)
+
 add_custom_command(
     OUTPUT ${xGUIPro_DERIVED_SOURCES_DIR}/gtk/BrowserMarshal.c
            ${xGUIPro_DERIVED_SOURCES_DIR}/gtk/BrowserMarshal.h
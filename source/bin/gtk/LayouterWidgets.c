@@ -512,10 +512,45 @@ gtk_imp_destroy_widget(void *workspace, void *session, void *window, void *widge
     return PCRDR_SC_OK;
 }
 
+/* A container or a pane is placed in the GtkFixed of its parent */
+static void
+move_widget_in_fixed(GtkWidget *widget, const struct ws_widget_info *style)
+{
+    GtkWidget *parent = gtk_widget_get_parent(widget);
+    if (parent && GTK_IS_FIXED(parent)) {
+        gtk_fixed_move(GTK_FIXED(parent), widget, style->x, style->y);
+    }
+    gtk_widget_set_size_request(widget, style->w, style->h);
+}
+
 void
 gtk_imp_update_widget(void *workspace, void *session, void *widget,
         ws_widget_type_t type, const struct ws_widget_info *style)
 {
+    if (!(style->flags & WSWS_FLAG_GEOMETRY)) {
+        return;
+    }
+
+    switch (type) {
+    case WS_WIDGET_TYPE_TABBEDWINDOW:
+        gtk_window_move(GTK_WINDOW(widget), style->x, style->y);
+        if (style->w > 0 && style->h > 0) {
+            gtk_window_resize(GTK_WINDOW(widget), style->w, style->h);
+        }
+        break;
+
+    case WS_WIDGET_TYPE_CONTAINER:
+    case WS_WIDGET_TYPE_PANEHOST:
+    case WS_WIDGET_TYPE_TABHOST:
+    case WS_WIDGET_TYPE_PANEDPAGE:
+        move_widget_in_fixed(GTK_WIDGET(widget), style);
+        break;
+
+    default:
+        /* a plain window has its own geometry, and the geometry of
+           a tabbed page is managed by its tab host */
+        break;
+    }
 }
 
 uint64_t gtk_imp_get_last_widget(void *session)
@@ -47,6 +47,11 @@ struct purcmc_workspace {
 
     /* manager of grouped plain windows and pages */
     struct ws_layouter *layouter;
+
+    /* the idle source to commit the pending layout batch */
+    guint layout_batch;
+    /* the session which opened the pending layout batch */
+    struct purcmc_session *batch_session;
 };
 
 struct purcmc_session {
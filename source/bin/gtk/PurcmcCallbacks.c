@@ -29,11 +29,15 @@
 #include "BuildRevision.h"
 #include "PurcmcCallbacks.h"
 #include "schema/HVMLURISchema.h"
+#include "schema/AssetCache.h"
+#include "schema/MimeTypes.h"
+#include "schema/DocumentStream.h"
 #include "LayouterWidgets.h"
 
 #include "purcmc/purcmc.h"
 #include "layouter/layouter.h"
 #include "utils/utils.h"
+#include "utils/hvml-uri.h"
 
 #include <errno.h>
 #include <assert.h>
@@ -44,11 +48,52 @@
 
 static KVLIST(kv_app_workspace, NULL);
 
+/* the web contexts shared by sessions, keyed by the app or the pool slot */
+static KVLIST(kv_web_contexts, NULL);
+static unsigned next_pooled_web_context;
+
 int pcmc_gtk_prepare(purcmc_server *srv)
 {
     return 0;
 }
 
+static gboolean commit_layout_batch(gpointer user_data)
+{
+    purcmc_workspace *workspace = user_data;
+
+    workspace->layout_batch = 0;
+    ws_layouter_commit(workspace->layouter, workspace->batch_session);
+    workspace->batch_session = NULL;
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * A burst of requests (e.g. the `createWidget` requests for the pages of
+ * a tabbed window) is handled in one iteration of the main loop, so the
+ * widgets are laid out once when the main loop becomes idle; the priority
+ * makes the batch committed before the next redrawing.
+ */
+static void begin_layout_batch(purcmc_session *sess,
+        purcmc_workspace *workspace)
+{
+    if (workspace->layout_batch == 0) {
+        ws_layouter_begin_batch(workspace->layouter);
+        workspace->batch_session = sess;
+        workspace->layout_batch = g_idle_add_full(G_PRIORITY_HIGH_IDLE,
+                commit_layout_batch, workspace, NULL);
+    }
+}
+
+/* Call this before deleting the layouter */
+static void cancel_layout_batch(purcmc_workspace *workspace)
+{
+    if (workspace->layout_batch) {
+        g_source_remove(workspace->layout_batch);
+        workspace->layout_batch = 0;
+        workspace->batch_session = NULL;
+    }
+}
+
 void pcmc_gtk_cleanup(purcmc_server *srv)
 {
     const char *name;
@@ -59,11 +104,22 @@ void pcmc_gtk_cleanup(purcmc_server *srv)
 
         pcutils_kvlist_delete(workspace->page_owners);
         if (workspace->layouter) {
+            cancel_layout_batch(workspace);
             ws_layouter_delete(workspace->layouter, NULL);
         }
     }
 
     kvlist_free(&kv_app_workspace);
+
+    kvlist_for_each_safe(&kv_web_contexts, name, next, data) {
+        WebKitWebContext *web_context = *(WebKitWebContext **)data;
+        g_object_unref(web_context);
+    }
+    kvlist_free(&kv_web_contexts);
+
+    ws_layouter_cleanup_cache();
+    asset_cache_cleanup();
+    mime_types_cleanup();
 }
 
 static purcmc_workspace *create_or_get_workspace(purcmc_endpoint* endpoint)
@@ -125,6 +181,13 @@ struct packed_result {
     char plain[0];
 };
 
+static void finish_response(purcmc_session* sess, const char *request_id,
+        unsigned int ret_code, purc_variant_t ret_data);
+static bool is_deferred_request(purcmc_session *sess, purcmc_page *page,
+        const char *request_id);
+static bool is_streamed_request(purcmc_session *sess, purcmc_page *page,
+        const char *request_id);
+
 bool gtk_pend_response(purcmc_session* sess, purcmc_page *page,
         const char *operation, const char *request_id, void *result_value,
         const char *plain)
@@ -150,6 +213,14 @@ bool gtk_pend_response(purcmc_session* sess, purcmc_page *page,
         }
 
         kvlist_set(&sess->pending_responses, request_id, &packed);
+
+        /* The request is for a page not loaded yet; answer it now.
+           For createWidget, the page is the result value. */
+        if (page == NULL)
+            page = result_value;
+        if (page && (is_deferred_request(sess, page, request_id) ||
+                    is_streamed_request(sess, page, request_id)))
+            finish_response(sess, request_id, PCRDR_SC_OK, NULL);
     }
 
     return true;
@@ -252,6 +323,8 @@ static void handle_response_from_webpage(purcmc_session *sess,
     purc_variant_unref(result);
 }
 
+static void on_deferred_page_ready(WebKitWebView *webview);
+
 static gboolean
 user_message_received_callback(WebKitWebView *webview,
         WebKitUserMessage *message, gpointer user_data)
@@ -272,6 +345,8 @@ user_message_received_callback(WebKitWebView *webview,
             LOG_ERROR("the parameter of the message is not a string (%s)\n",
                     type);
         }
+
+        on_deferred_page_ready(webview);
     }
     else if (strcmp(name, "event") == 0) {
         GVariant *param = webkit_user_message_get_parameters(message);
@@ -345,6 +420,219 @@ out:
     return TRUE;
 }
 
+static WebKitWebContext *create_web_context(WebKitSettings *webkit_settings)
+{
+    WebKitWebsiteDataManager *manager;
+    manager = g_object_get_data(G_OBJECT(webkit_settings),
+            "default-website-data-manager");
+
+    WebKitWebContext *web_context = g_object_new(WEBKIT_TYPE_WEB_CONTEXT,
+            "website-data-manager", manager,
+            "process-swap-on-cross-site-navigation-enabled", TRUE,
+#if !GTK_CHECK_VERSION(3, 98, 0) && WEBKIT_CHECK_VERSION(2, 30, 0)
+            "use-system-appearance-for-scrollbars", FALSE,
+#endif
+            NULL);
+
+    g_signal_connect(web_context, "initialize-web-extensions",
+            G_CALLBACK(initializeWebExtensionsCallback), (gpointer)"HVML");
+
+    // hvml schema; the session is resolved from the requesting web view
+    webkit_web_context_register_uri_scheme(web_context,
+            BROWSER_HVML_SCHEME,
+            (WebKitURISchemeRequestCallback)hvmlURISchemeRequestCallback,
+            web_context, NULL);
+
+    return web_context;
+}
+
+/*
+ * Returns a new reference to the web context for a new session according
+ * to the policy given by `--pcmc-webcontext`:
+ *  - `session`: a new context for every session (the default);
+ *  - `app`: one context shared by all sessions of an app;
+ *  - `pool:N`: N contexts assigned to the sessions in turn.
+ * Sharing a context saves launching a new network process and initializing
+ * the web extensions again for each runner.
+ */
+static WebKitWebContext *get_web_context(WebKitSettings *webkit_settings,
+        purcmc_endpoint* endpoint)
+{
+    char key[PURC_LEN_ENDPOINT_NAME + 1];
+    const char *policy = g_object_get_data(G_OBJECT(webkit_settings),
+            "purcmc-webcontext-policy");
+
+    if (policy == NULL || strcmp(policy, "session") == 0) {
+        return create_web_context(webkit_settings);
+    }
+    else if (strcmp(policy, "app") == 0) {
+        sprintf(key, "%s-%s", purcmc_endpoint_host_name(endpoint),
+                purcmc_endpoint_app_name(endpoint));
+    }
+    else if (strncmp(policy, "pool:", 5) == 0 && atoi(policy + 5) > 0) {
+        unsigned nr_contexts = (unsigned)atoi(policy + 5);
+        sprintf(key, "pool-%u", next_pooled_web_context++ % nr_contexts);
+    }
+    else {
+        LOG_WARN("Unknown web context policy: %s\n", policy);
+        return create_web_context(webkit_settings);
+    }
+
+    void *data;
+    WebKitWebContext *web_context;
+    if ((data = kvlist_get(&kv_web_contexts, key))) {
+        web_context = *(WebKitWebContext **)data;
+    }
+    else {
+        web_context = create_web_context(webkit_settings);
+        g_object_set_data(G_OBJECT(web_context), "purcmc-shared-context",
+                GINT_TO_POINTER(1));
+        kvlist_set(&kv_web_contexts, key, &web_context);
+        LOG_INFO("Created the shared web context for %s\n", key);
+    }
+
+    return g_object_ref(web_context);
+}
+
+static WebKitWebView *new_web_view(WebKitSettings *webkit_settings,
+        WebKitWebContext *web_context)
+{
+#if WEBKIT_CHECK_VERSION(2, 30, 0)
+    WebKitWebsitePolicies *website_policies;
+    website_policies = g_object_get_data(G_OBJECT(webkit_settings),
+            "default-website-policies");
+#endif
+
+    WebKitUserContentManager *uc_manager;
+    uc_manager = g_object_get_data(G_OBJECT(webkit_settings),
+            "default-user-content-manager");
+
+    WebKitWebView *webView = WEBKIT_WEB_VIEW(g_object_new(WEBKIT_TYPE_WEB_VIEW,
+                "web-context", web_context,
+                "settings", webkit_settings,
+                "user-content-manager", uc_manager,
+                "is-controlled-by-automation", FALSE,
+#if WEBKIT_CHECK_VERSION(2, 30, 0)
+                "website-policies", website_policies,
+#endif
+                NULL));
+    return webView;
+}
+
+/*
+ * A pool of pre-created web views per shared web context. A pooled web view has
+ * loaded a blank page, so its web process is launched and the web
+ * extension initialized before the interpreter creates a page. The pool
+ * is refilled when the main loop is idle. `--pcmc-webview-pool` sets the
+ * size of a pool; `--pcmc-webview-pool-max` caps the number of idle web
+ * views (each holding a web process) in all pools.
+ */
+struct webview_pool {
+    WebKitSettings *webkit_settings;
+    WebKitWebContext *web_context;
+    GQueue *idle;
+    guint refill;
+    unsigned nr_sessions;
+};
+
+static unsigned nr_idle_web_views;
+
+static unsigned webview_pool_option(WebKitSettings *webkit_settings,
+        const char *key)
+{
+    return GPOINTER_TO_UINT(g_object_get_data(G_OBJECT(webkit_settings), key));
+}
+
+static gboolean refill_webview_pool(gpointer user_data)
+{
+    struct webview_pool *pool = user_data;
+    unsigned size = webview_pool_option(pool->webkit_settings,
+            "purcmc-webview-pool-size");
+    unsigned max = webview_pool_option(pool->webkit_settings,
+            "purcmc-webview-pool-max");
+
+    if (pool->nr_sessions > 0 && g_queue_get_length(pool->idle) < size &&
+            nr_idle_web_views < max) {
+        WebKitWebView *webview = new_web_view(pool->webkit_settings,
+                pool->web_context);
+        g_object_ref_sink(webview);
+        webkit_web_view_load_uri(webview, "about:blank");
+        g_queue_push_tail(pool->idle, webview);
+        nr_idle_web_views++;
+
+        if (g_queue_get_length(pool->idle) < size && nr_idle_web_views < max)
+            return G_SOURCE_CONTINUE;
+    }
+
+    pool->refill = 0;
+    return G_SOURCE_REMOVE;
+}
+
+static void refill_webview_pool_later(struct webview_pool *pool)
+{
+    if (pool->refill == 0) {
+        pool->refill = g_idle_add_full(G_PRIORITY_LOW,
+                refill_webview_pool, pool, NULL);
+    }
+}
+
+static void drain_webview_pool(struct webview_pool *pool)
+{
+    if (pool->refill) {
+        g_source_remove(pool->refill);
+        pool->refill = 0;
+    }
+
+    WebKitWebView *webview;
+    while ((webview = g_queue_pop_head(pool->idle))) {
+        gtk_widget_destroy(GTK_WIDGET(webview));
+        g_object_unref(webview);
+        nr_idle_web_views--;
+    }
+}
+
+static void free_webview_pool(gpointer data)
+{
+    struct webview_pool *pool = data;
+    drain_webview_pool(pool);
+    g_queue_free(pool->idle);
+    g_free(pool);
+}
+
+/* Only a web context shared by sessions has a pool: a context per session
+   would spawn a web process which the session may never use. */
+static void webview_pool_attach_session(WebKitSettings *webkit_settings,
+        WebKitWebContext *web_context)
+{
+    if (!g_object_get_data(G_OBJECT(web_context), "purcmc-shared-context"))
+        return;
+
+    struct webview_pool *pool = g_object_get_data(G_OBJECT(web_context),
+            "purcmc-webview-pool");
+    if (pool == NULL) {
+        pool = g_new0(struct webview_pool, 1);
+        pool->webkit_settings = webkit_settings;
+        pool->web_context = web_context;
+        pool->idle = g_queue_new();
+        g_object_set_data_full(G_OBJECT(web_context), "purcmc-webview-pool",
+                pool, free_webview_pool);
+    }
+
+    pool->nr_sessions++;
+    refill_webview_pool_later(pool);
+}
+
+/* The pooled web views hold the web context; drain the pool when no
+   session uses the context any more. */
+static void webview_pool_detach_session(WebKitWebContext *web_context)
+{
+    struct webview_pool *pool = g_object_get_data(G_OBJECT(web_context),
+            "purcmc-webview-pool");
+    if (pool && --pool->nr_sessions == 0) {
+        drain_webview_pool(pool);
+    }
+}
+
 purcmc_session *gtk_create_session(purcmc_server *srv, purcmc_endpoint *endpt)
 {
     purcmc_session* sess = calloc(1, sizeof(purcmc_session));
@@ -370,31 +658,12 @@ purcmc_session *gtk_create_session(purcmc_server *srv, purcmc_endpoint *endpt)
 
     sess->srv = srv;
     WebKitSettings *webkit_settings = purcmc_rdrsrv_get_user_data(srv);
-    WebKitWebsiteDataManager *manager;
-    manager = g_object_get_data(G_OBJECT(webkit_settings),
-            "default-website-data-manager");
-
-    WebKitWebContext *web_context = g_object_new(WEBKIT_TYPE_WEB_CONTEXT,
-            "website-data-manager", manager,
-            "process-swap-on-cross-site-navigation-enabled", TRUE,
-#if !GTK_CHECK_VERSION(3, 98, 0) && WEBKIT_CHECK_VERSION(2, 30, 0)
-            "use-system-appearance-for-scrollbars", FALSE,
-#endif
-            NULL);
-    g_object_unref(manager);
-
-    g_signal_connect(web_context, "initialize-web-extensions",
-            G_CALLBACK(initializeWebExtensionsCallback), (gpointer)"HVML");
-
-    // hvml schema
-    webkit_web_context_register_uri_scheme(web_context,
-            BROWSER_HVML_SCHEME,
-            (WebKitURISchemeRequestCallback)hvmlURISchemeRequestCallback,
-            web_context, NULL);
+    WebKitWebContext *web_context = get_web_context(webkit_settings, endpt);
 
     sess->webkit_settings = webkit_settings;
     sess->web_context = web_context;
     sess->allow_switching_rdr = purcmc_endpoint_allow_switching_rdr(endpt);
+    webview_pool_attach_session(webkit_settings, web_context);
 
     kvlist_init(&sess->pending_responses, NULL);
     return sess;
@@ -444,6 +713,7 @@ int gtk_remove_session(purcmc_session *sess)
 
     LOG_DEBUG("deleting layouter ...\n");
     if (sess->workspace->layouter) {
+        cancel_layout_batch(sess->workspace);
         ws_layouter_delete(sess->workspace->layouter, sess);
         sess->workspace->layouter = NULL;
     }
@@ -451,6 +721,11 @@ int gtk_remove_session(purcmc_session *sess)
     LOG_DEBUG("destroy sorted array for all handles...\n");
     sorted_array_destroy(sess->all_handles);
 
+    if (sess->web_context) {
+        webview_pool_detach_session(sess->web_context);
+        g_object_unref(G_OBJECT(sess->web_context));
+    }
+
     LOG_DEBUG("destroy kvlist for pending responses...\n");
     const char *name;
     void *data;
@@ -521,33 +796,454 @@ static gboolean on_webview_close(WebKitWebView *webview, purcmc_session *sess)
     return FALSE;
 }
 
-static WebKitWebView *create_web_view(purcmc_session *sess)
+/* Do not take a pooled web view for a page which will not load its URI
+   at once (see web_view_load_uri()): the web process of the pooled view
+   would stay idle, and the refill would launch another one. */
+static WebKitWebView *create_web_view(purcmc_session *sess, bool pooled)
 {
-#if WEBKIT_CHECK_VERSION(2, 30, 0)
-    WebKitWebsitePolicies *website_policies;
-    website_policies = g_object_get_data(G_OBJECT(sess->webkit_settings),
-            "default-website-policies");
+    struct webview_pool *pool = pooled ?
+        g_object_get_data(G_OBJECT(sess->web_context),
+            "purcmc-webview-pool") : NULL;
+
+    WebKitWebView *webView = NULL;
+    if (pool && (webView = g_queue_pop_head(pool->idle))) {
+        nr_idle_web_views--;
+        /* hand our reference over as a floating one, like a new widget */
+        g_object_force_floating(G_OBJECT(webView));
+        refill_webview_pool_later(pool);
+    }
+    else {
+        webView = new_web_view(sess->webkit_settings, sess->web_context);
+    }
+
+    return webView;
+}
+
+static void
+request_ready_callback(GObject* obj, GAsyncResult* result, gpointer user_data);
+
+/* A tabbed page not shown yet does not load its URI (and so does not
+   spawn any web content) until it is mapped for the first time. A page
+   hidden for a while is suspended: its DOM is serialized, its web process
+   terminated, and it is restored from the snapshot when mapped again.
+   A live page which is hidden (unmapped or iconified) is deferred too, so
+   that a burst of DOM operations is coalesced while nobody sees them.
+
+   The requests sent to a deferred page are queued and replayed once the
+   page is shown, which may never happen; so they are answered with Ok
+   when queued, and a failure on replay is only logged. Only the requests
+   queued while the page is being loaded for showing it are answered by
+   the page, since they are replayed as soon as it is ready. */
+
+struct deferred_page {
+    gchar *uri;
+    gchar *initial_request_id;
+    gchar *snapshot;
+    GQueue *requests;
+    gulong map_handler;
+    /* the web content is still alive, e.g. while taking the snapshot */
+    bool live;
+    /* the URI is being loaded; waiting for `page-ready` */
+    bool loading;
+};
+
+struct queued_request {
+    gchar *request_id;
+    gchar *json;
+    /* the target of an `update`; a later one to the same target wins */
+    gchar *target;
+    /* the response must come from the page */
+    bool needs_reply;
+};
+
+static void free_queued_request(gpointer data)
+{
+    struct queued_request *request = data;
+    g_free(request->request_id);
+    g_free(request->json);
+    g_free(request->target);
+    g_free(request);
+}
+
+static void free_deferred_page(gpointer data)
+{
+    struct deferred_page *deferred = data;
+    g_free(deferred->uri);
+    g_free(deferred->initial_request_id);
+    g_free(deferred->snapshot);
+    g_queue_free_full(deferred->requests, free_queued_request);
+    g_free(deferred);
+}
+
+static void send_json_to_page(purcmc_session *sess, WebKitWebView *webview,
+        const gchar *json)
+{
+    WebKitUserMessage * message = webkit_user_message_new("request",
+            g_variant_new_string(json));
+
+    webkit_web_view_send_message_to_page(webview, message, NULL,
+            request_ready_callback, sess);
+}
+
+#define RESTORE_MESSAGE_FORMAT  "{"      \
+        "\"operation\":\"load\","           \
+        "\"requestId\":\"-\","              \
+        "\"data\":\"%s\"}"
+
+struct restore_info {
+    size_t len_snapshot;
+    gint64 start;
+};
+
+static void
+restore_ready_callback(GObject* obj, GAsyncResult* result, gpointer user_data)
+{
+    struct restore_info *info = user_data;
+    WebKitUserMessage *message;
+
+    message = webkit_web_view_send_message_to_page_finish(WEBKIT_WEB_VIEW(obj),
+            result, NULL);
+    LOG_INFO("page (%p) restored from a snapshot of %zu bytes in %.1f ms%s\n",
+            obj, info->len_snapshot,
+            (g_get_monotonic_time() - info->start) / 1000.0,
+            message ? "" : " (failed)");
+    g_free(info);
+}
+
+static void replay_queued_requests(WebKitWebView *webview,
+        struct deferred_page *deferred)
+{
+    purcmc_session *sess = g_object_get_data(G_OBJECT(webview),
+            "purcmc-session");
+    struct queued_request *request;
+    while ((request = g_queue_pop_head(deferred->requests))) {
+        send_json_to_page(sess, webview, request->json);
+        free_queued_request(request);
+    }
+}
+
+/* Restores the snapshot if any, and replays the queued requests. */
+static void flush_deferred_page(WebKitWebView *webview)
+{
+    struct deferred_page *deferred;
+    deferred = g_object_steal_data(G_OBJECT(webview), "purcmc-deferred-page");
+    if (deferred == NULL)
+        return;
+
+    if (deferred->map_handler)
+        g_signal_handler_disconnect(webview, deferred->map_handler);
+
+    if (deferred->snapshot) {
+        struct restore_info *info = g_new(struct restore_info, 1);
+        info->len_snapshot = strlen(deferred->snapshot);
+        info->start = g_get_monotonic_time();
+
+        char *escaped = pcutils_escape_string_for_json(deferred->snapshot);
+        gchar *json = g_strdup_printf(RESTORE_MESSAGE_FORMAT,
+                escaped ? escaped : "");
+        free(escaped);
+
+        WebKitUserMessage * message = webkit_user_message_new("request",
+                g_variant_new_string(json));
+        g_free(json);
+        webkit_web_view_send_message_to_page(webview, message, NULL,
+                restore_ready_callback, info);
+    }
+
+    replay_queued_requests(webview, deferred);
+    free_deferred_page(deferred);
+}
+
+static void load_deferred_page(WebKitWebView *webview)
+{
+    struct deferred_page *deferred;
+    deferred = g_object_get_data(G_OBJECT(webview), "purcmc-deferred-page");
+    if (deferred == NULL)
+        return;
+
+    if (deferred->live) {
+        flush_deferred_page(webview);
+    }
+    else if (!deferred->loading) {
+        LOG_DEBUG("loading deferred page (%p): %s\n", webview, deferred->uri);
+        g_signal_handler_disconnect(webview, deferred->map_handler);
+        deferred->map_handler = 0;
+        deferred->loading = true;
+        webkit_web_view_load_uri(webview, deferred->uri);
+    }
+}
+
+static void on_deferred_page_mapped(GtkWidget *widget, gpointer user_data)
+{
+    (void)user_data;
+    load_deferred_page(WEBKIT_WEB_VIEW(widget));
+}
+
+static void on_deferred_page_ready(WebKitWebView *webview)
+{
+    struct deferred_page *deferred;
+    deferred = g_object_get_data(G_OBJECT(webview), "purcmc-deferred-page");
+    if (deferred && deferred->loading)
+        flush_deferred_page(webview);
+}
+
+static struct deferred_page *defer_page(WebKitWebView *webview,
+        const char *uri, const char *request_id, bool live)
+{
+    struct deferred_page *deferred = g_new0(struct deferred_page, 1);
+    deferred->uri = g_strdup(uri);
+    deferred->initial_request_id = g_strdup(request_id);
+    deferred->requests = g_queue_new();
+    deferred->live = live;
+    deferred->map_handler = g_signal_connect(webview, "map",
+            G_CALLBACK(on_deferred_page_mapped), NULL);
+    g_object_set_data_full(G_OBJECT(webview), "purcmc-deferred-page",
+            deferred, free_deferred_page);
+    return deferred;
+}
+
+#if WEBKIT_CHECK_VERSION(2, 34, 0)
+#define DEF_SUSPEND_AFTER_SECONDS   60
+
+#define SNAPSHOT_MESSAGE_FORMAT  "{"        \
+        "\"operation\":\"getProperty\","    \
+        "\"requestId\":\"-\","              \
+        "\"elementType\":\"void\","         \
+        "\"element\":\"\","                 \
+        "\"property\":\"documentElement.outerHTML\"}"
+
+static guint suspend_after_seconds(void)
+{
+    static int seconds = -1;
+
+    if (seconds < 0) {
+        const char *env = g_getenv("XGUIPRO_SUSPEND_HIDDEN_PAGES");
+        seconds = env ? atoi(env) : DEF_SUSPEND_AFTER_SECONDS;
+        if (seconds < 0)
+            seconds = 0;
+    }
+
+    return (guint)seconds;
+}
+
+static void
+snapshot_ready_callback(GObject* obj, GAsyncResult* result, gpointer user_data)
+{
+    WebKitWebView *webview = WEBKIT_WEB_VIEW(obj);
+    (void)user_data;
+
+    WebKitUserMessage *message;
+    message = webkit_web_view_send_message_to_page_finish(webview, result, NULL);
+
+    struct deferred_page *deferred;
+    deferred = g_object_get_data(G_OBJECT(webview), "purcmc-deferred-page");
+    if (deferred == NULL || !deferred->live) {
+        /* flushed before the snapshot is ready */
+        return;
+    }
+
+    purc_variant_t snapshot = PURC_VARIANT_INVALID;
+    if (message) {
+        GVariant *param = webkit_user_message_get_parameters(message);
+        if (strcmp(g_variant_get_type_string(param), "s") == 0) {
+            size_t len;
+            const char *str = g_variant_get_string(param, &len);
+            snapshot = purc_variant_make_from_json_string(str, len);
+        }
+    }
+
+    const char *html = NULL;
+    if (snapshot) {
+        purc_variant_t data = purc_variant_object_get_by_ckey(snapshot, "data");
+        if (data)
+            html = purc_variant_get_string_const(data);
+    }
+
+    if (html == NULL) {
+        LOG_WARN("failed to take the snapshot of page (%p)\n", webview);
+        flush_deferred_page(webview);
+    }
+    else if (gtk_widget_get_mapped(GTK_WIDGET(webview))) {
+        flush_deferred_page(webview);
+    }
+    else {
+        deferred->snapshot = g_strdup_printf("<!DOCTYPE html>\n%s", html);
+        deferred->live = false;
+        webkit_web_view_terminate_web_process(webview);
+        LOG_INFO("page (%p) suspended: web process released, "
+                "kept a snapshot of %zu bytes\n",
+                webview, strlen(deferred->snapshot));
+    }
+
+    if (snapshot)
+        purc_variant_unref(snapshot);
+}
+
+static gboolean suspend_hidden_page(gpointer user_data)
+{
+    WebKitWebView *webview = user_data;
+
+    g_object_set_data(G_OBJECT(webview), "purcmc-suspend-timer", NULL);
+    if (webkit_web_view_is_loading(webview))
+        return G_SOURCE_REMOVE;
+
+    /* the requests queued since the page was hidden are replayed after
+       the snapshot is restored */
+    struct deferred_page *deferred;
+    deferred = g_object_get_data(G_OBJECT(webview), "purcmc-deferred-page");
+    if (deferred == NULL)
+        deferred = defer_page(webview, webkit_web_view_get_uri(webview), NULL,
+                true);
+    else if (!deferred->live || deferred->loading)
+        return G_SOURCE_REMOVE;
+
+    WebKitUserMessage * message = webkit_user_message_new("request",
+            g_variant_new_string(SNAPSHOT_MESSAGE_FORMAT));
+    webkit_web_view_send_message_to_page(webview, message, NULL,
+            snapshot_ready_callback, NULL);
+    return G_SOURCE_REMOVE;
+}
+
+static void cancel_suspend_timer(GtkWidget *widget, gpointer user_data)
+{
+    (void)user_data;
+
+    guint timer = GPOINTER_TO_UINT(g_object_get_data(G_OBJECT(widget),
+                "purcmc-suspend-timer"));
+    if (timer) {
+        g_source_remove(timer);
+        g_object_set_data(G_OBJECT(widget), "purcmc-suspend-timer", NULL);
+    }
+}
+
+static void start_suspend_timer(GtkWidget *widget)
+{
+    cancel_suspend_timer(widget, NULL);
+
+    guint seconds = suspend_after_seconds();
+    if (seconds > 0) {
+        guint timer = g_timeout_add_seconds(seconds,
+                suspend_hidden_page, widget);
+        g_object_set_data(G_OBJECT(widget), "purcmc-suspend-timer",
+                GUINT_TO_POINTER(timer));
+    }
+}
+#endif /* WebKit 2.34+ */
+
+/* Buffers the DOM operations for a live page that has become hidden. */
+static void hide_page(WebKitWebView *webview)
+{
+    if (g_object_get_data(G_OBJECT(webview), "purcmc-deferred-page") == NULL)
+        defer_page(webview, webkit_web_view_get_uri(webview), NULL, true);
+}
+
+static void on_page_unmapped(GtkWidget *widget, gpointer user_data)
+{
+    (void)user_data;
+
+    hide_page(WEBKIT_WEB_VIEW(widget));
+#if WEBKIT_CHECK_VERSION(2, 34, 0)
+    /* suspend the page when it has been hidden for a while */
+    start_suspend_timer(widget);
 #endif
+}
 
-    WebKitUserContentManager *uc_manager;
-    uc_manager = g_object_get_data(G_OBJECT(sess->webkit_settings),
-            "default-user-content-manager");
+static gboolean on_page_window_state_changed(GtkWidget *window,
+        GdkEventWindowState *event, gpointer user_data)
+{
+    (void)window;
+    WebKitWebView *webview = user_data;
 
-    WebKitWebView *webView = WEBKIT_WEB_VIEW(g_object_new(WEBKIT_TYPE_WEB_VIEW,
-                "web-context", sess->web_context,
-                "settings", sess->webkit_settings,
-                "user-content-manager", uc_manager,
-                "is-controlled-by-automation", FALSE,
-#if WEBKIT_CHECK_VERSION(2, 30, 0)
-                "website-policies", website_policies,
+    if (event->changed_mask & GDK_WINDOW_STATE_ICONIFIED) {
+        if (event->new_window_state & GDK_WINDOW_STATE_ICONIFIED)
+            hide_page(webview);
+        else
+            load_deferred_page(webview);
+    }
+
+    return FALSE;
+}
+
+static void watch_page_visibility(WebKitWebView *webview)
+{
+    g_signal_connect(webview, "unmap", G_CALLBACK(on_page_unmapped), NULL);
+#if WEBKIT_CHECK_VERSION(2, 34, 0)
+    g_signal_connect(webview, "map", G_CALLBACK(cancel_suspend_timer), NULL);
+    g_signal_connect(webview, "destroy",
+            G_CALLBACK(cancel_suspend_timer), NULL);
 #endif
-                NULL));
-    return webView;
+
+    GtkWidget *toplevel = gtk_widget_get_toplevel(GTK_WIDGET(webview));
+    if (GTK_IS_WINDOW(toplevel)) {
+        g_signal_connect_object(toplevel, "window-state-event",
+                G_CALLBACK(on_page_window_state_changed), webview, 0);
+    }
+}
+
+/* Drops a queued `update` superseded by a new one to the same target,
+   unless another operation is queued in between. The dropped one is
+   answered if it has not been. */
+static void coalesce_queued_update(purcmc_session *sess,
+        struct deferred_page *deferred, const char *target)
+{
+    for (GList *l = deferred->requests->tail; l; l = l->prev) {
+        struct queued_request *request = l->data;
+        if (request->target == NULL || request->needs_reply)
+            break;
+
+        if (strcmp(request->target, target) == 0) {
+            LOG_DEBUG("update coalesced: %s\n", request->request_id);
+            finish_response(sess, request->request_id, PCRDR_SC_OK, NULL);
+            free_queued_request(request);
+            g_queue_delete_link(deferred->requests, l);
+            break;
+        }
+    }
+}
+
+/* Sends a request to the page, or queues it if the page is deferred.
+   A request needing a live DOM answer forces the page to be loaded.
+   `target` identifies the element property set by an `update` if not NULL.
+   Takes the ownership of `json`. */
+static void send_request_to_page(purcmc_session *sess, WebKitWebView *webview,
+        const char *request_id, gchar *json, const char *target,
+        bool needs_reply)
+{
+    if (needs_reply)
+        load_deferred_page(webview);
+
+    struct deferred_page *deferred;
+    deferred = g_object_get_data(G_OBJECT(webview), "purcmc-deferred-page");
+    if (deferred) {
+        struct queued_request *request = g_new(struct queued_request, 1);
+        request->request_id = g_strdup(request_id);
+        request->json = json;
+        request->target = NULL;
+        request->needs_reply = needs_reply;
+        if (target) {
+            coalesce_queued_update(sess, deferred, target);
+            request->target = g_strdup(target);
+        }
+        g_queue_push_tail(deferred->requests, request);
+    }
+    else {
+        send_json_to_page(sess, webview, json);
+        g_free(json);
+    }
+}
+
+/* Matches a queued request which is answered before it is replayed. */
+static int cmp_request_id(gconstpointer data, gconstpointer request_id)
+{
+    const struct queued_request *request = data;
+    if (request->needs_reply)
+        return -1;
+    return strcmp(request->request_id, request_id);
 }
 
 static void web_view_load_uri(WebKitWebView *webview,
         purcmc_session *sess, const char *group, const char *name,
-        const char *request_id)
+        const char *request_id, bool deferred)
 {
     g_signal_connect(webview, "close",
             G_CALLBACK(on_webview_close), sess);
@@ -566,11 +1262,20 @@ static void web_view_load_uri(WebKitWebView *webview,
         strcat(uri, "-/");
     }
     strcat(uri, name);
+    g_object_set_data_full(G_OBJECT(webview), "purcmc-page-uri",
+            g_strdup(uri), g_free);
     strcat(uri, "?irId=");
     strcat(uri, request_id);
+    g_object_set_data_full(G_OBJECT(webview), "purcmc-load-uri",
+            g_strdup(uri), g_free);
 
     g_object_set_data(G_OBJECT(webview), "purcmc-session", sess);
-    webkit_web_view_load_uri(webview, uri);
+    if (deferred) {
+        defer_page(webview, uri, request_id, false);
+    }
+    else {
+        webkit_web_view_load_uri(webview, uri);
+    }
 }
 
 struct find_first_page {
@@ -873,6 +1578,50 @@ static inline WebKitWebView *validate_handle(purcmc_session *sess,
     return (WebKitWebView *)page;
 }
 
+static bool is_deferred_request(purcmc_session *sess, purcmc_page *page,
+        const char *request_id)
+{
+    int retv;
+    WebKitWebView *webview = validate_handle(sess, page, &retv);
+    if (webview == NULL)
+        return false;
+
+    struct deferred_page *deferred;
+    deferred = g_object_get_data(G_OBJECT(webview), "purcmc-deferred-page");
+    if (deferred == NULL)
+        return false;
+
+    if (deferred->initial_request_id &&
+            strcmp(deferred->initial_request_id, request_id) == 0)
+        return true;
+
+    /* the page answers the requests replayed once it is ready */
+    if (deferred->loading)
+        return false;
+
+    return g_queue_find_custom(deferred->requests, request_id,
+            cmp_request_id) != NULL;
+}
+
+/* Matches the last writeBegin or writeMore fed to a document stream;
+   the writeEnd is answered once the stream is loaded. */
+static bool is_streamed_request(purcmc_session *sess, purcmc_page *page,
+        const char *request_id)
+{
+    int retv;
+    WebKitWebView *webview = validate_handle(sess, page, &retv);
+    if (webview == NULL)
+        return false;
+
+    const char *streamed = g_object_get_data(G_OBJECT(webview),
+            "purcmc-streamed-request");
+    if (streamed == NULL || strcmp(streamed, request_id))
+        return false;
+
+    g_object_set_data(G_OBJECT(webview), "purcmc-streamed-request", NULL);
+    return true;
+}
+
 purcmc_page *gtk_create_plainwin(purcmc_session *sess,
         purcmc_workspace *workspace, const char *request_id,
         const char *page_id, const char *group, const char *name,
@@ -889,7 +1638,7 @@ purcmc_page *gtk_create_plainwin(purcmc_session *sess,
         goto done;
     }
 
-    WebKitWebView *webview = create_web_view(sess);
+    WebKitWebView *webview = create_web_view(sess, true);
 
     if (group == NULL) {
         /* create a ungrouped plain window */
@@ -932,10 +1681,11 @@ purcmc_page *gtk_create_plainwin(purcmc_session *sess,
             purc_page_ostack_new(workspace->page_owners, page_id, webview);
         g_object_set_data(G_OBJECT(webview), "purcmc-owner-stack", ostack);
 
-        web_view_load_uri(webview, sess, group, name, request_id);
+        web_view_load_uri(webview, sess, group, name, request_id, false);
 
         gtk_widget_grab_focus(GTK_WIDGET(webview));
         gtk_widget_show(GTK_WIDGET(plainwin));
+        watch_page_visibility(webview);
 
         sorted_array_add(sess->all_handles, PTR2U64(plainwin),
                 INT2PTR(HT_PLAINWIN));
@@ -1171,6 +1921,218 @@ gtk_revoke_crtn(purcmc_session *sess, purcmc_page *page,
         "\"requestId\":\"%s\","     \
         "\"data\":\"%s\"}"
 
+#define STREAM_URI_FORMAT   "%s"                    \
+        "?irId=" PCRDR_REQUESTID_NORETURN           \
+        "&loadFromURL=1&stream=%u"                  \
+        "&host=%.*s&app=%.*s&runner=%.*s"           \
+        "&group=%.*s&page=%.*s"
+
+static unsigned next_stream_serial;
+
+/* the request identifier of the writeEnd fed to the stream */
+#define STREAM_END_REQUEST_KEY  "purcmc-stream-end-request"
+
+/* Queues a request in front of the ones queued to a deferred page. */
+static void queue_request_first(struct deferred_page *deferred,
+        const char *request_id, gchar *json)
+{
+    struct queued_request *request = g_new0(struct queued_request, 1);
+    request->request_id = g_strdup(request_id);
+    request->json = json;
+    g_queue_push_head(deferred->requests, request);
+}
+
+/* Answers the writeEnd fed to the stream, and replays the requests queued
+   while the stream was being loaded. */
+static void finish_stream(WebKitWebView *webview, unsigned int ret_code)
+{
+    purcmc_session *sess = g_object_get_data(G_OBJECT(webview),
+            "purcmc-session");
+    const char *end_request = g_object_get_data(G_OBJECT(webview),
+            STREAM_END_REQUEST_KEY);
+    if (end_request)
+        finish_response(sess, end_request, ret_code, NULL);
+    g_object_set_data(G_OBJECT(webview), STREAM_END_REQUEST_KEY, NULL);
+    g_object_set_data(G_OBJECT(webview), DOC_STREAM_URI_KEY, NULL);
+
+    struct deferred_page *deferred;
+    deferred = g_object_get_data(G_OBJECT(webview), "purcmc-deferred-page");
+    if (deferred && deferred->loading) {
+        flush_deferred_page(webview);
+        if (!gtk_widget_get_mapped(GTK_WIDGET(webview)))
+            hide_page(webview);
+    }
+}
+
+static void on_stream_load_changed(WebKitWebView *webview,
+        WebKitLoadEvent load_event, gpointer user_data)
+{
+    (void)user_data;
+
+    if (load_event != WEBKIT_LOAD_FINISHED)
+        return;
+
+    /* the load finishes only after the whole document has been read;
+       a failed load has been handled by on_stream_load_failed() */
+    struct doc_stream *ds;
+    ds = g_object_get_data(G_OBJECT(webview), DOC_STREAM_KEY);
+    if (ds && g_object_get_data(G_OBJECT(webview), DOC_STREAM_URI_KEY) &&
+            doc_stream_is_done(ds))
+        finish_stream(webview, PCRDR_SC_OK);
+}
+
+/* If the load of the stream failed before WebKit took its input, reloads
+   the page and sends the document written so far to it as requests once
+   it is ready; the chunks written later are sent as requests too. */
+static gboolean on_stream_load_failed(WebKitWebView *webview,
+        WebKitLoadEvent load_event, gchar *failing_uri, GError *error,
+        gpointer user_data)
+{
+    (void)load_event;
+    (void)user_data;
+
+    struct doc_stream *ds;
+    ds = g_object_get_data(G_OBJECT(webview), DOC_STREAM_KEY);
+    const char *stream_uri = g_object_get_data(G_OBJECT(webview),
+            DOC_STREAM_URI_KEY);
+    if (ds == NULL || stream_uri == NULL || strcmp(failing_uri, stream_uri))
+        return FALSE;
+
+    LOG_WARN("Failed to load the document stream (%s): %s\n",
+            failing_uri, error->message);
+
+    bool ended;
+    GBytes *doc = doc_stream_abandon(ds, &ended);
+    struct deferred_page *deferred;
+    deferred = g_object_get_data(G_OBJECT(webview), "purcmc-deferred-page");
+    if (doc == NULL || deferred == NULL || !deferred->loading) {
+        /* the document has been partly read */
+        if (doc)
+            g_bytes_unref(doc);
+        finish_stream(webview, PCRDR_SC_INTERNAL_SERVER_ERROR);
+        return FALSE;
+    }
+
+    /* the page answers the writeEnd once it is replayed */
+    if (ended) {
+        const char *end_request = g_object_get_data(G_OBJECT(webview),
+                STREAM_END_REQUEST_KEY);
+        if (end_request == NULL)
+            end_request = PCRDR_REQUESTID_NORETURN;
+        queue_request_first(deferred, end_request,
+                g_strdup_printf(PAGE_MESSAGE_FORMAT,
+                    PCRDR_OPERATION_WRITEEND, end_request, ""));
+    }
+
+    gsize len;
+    const char *data = g_bytes_get_data(doc, &len);
+    char *content = g_strndup(data, len);
+    char *escaped = pcutils_escape_string_for_json(content);
+    g_free(content);
+    g_bytes_unref(doc);
+
+    /* the chunks have been answered */
+    queue_request_first(deferred, PCRDR_REQUESTID_NORETURN,
+            g_strdup_printf(PAGE_MESSAGE_FORMAT,
+                PCRDR_OPERATION_WRITEBEGIN, PCRDR_REQUESTID_NORETURN,
+                escaped ? escaped : ""));
+    free(escaped);
+
+    g_object_set_data(G_OBJECT(webview), STREAM_END_REQUEST_KEY, NULL);
+    g_object_set_data(G_OBJECT(webview), DOC_STREAM_URI_KEY, NULL);
+    webkit_web_view_load_uri(webview, deferred->uri);
+    return FALSE;
+}
+
+/* Feeds a chunk written by writeBegin, writeMore, or writeEnd to the
+   document stream of the page. On writeBegin, the page loads the stream
+   instead of calling document.write() for every chunk; the requests sent
+   to the page meanwhile are queued until the stream is loaded.
+   Returns false if the chunk should be sent to the page as a request. */
+static bool stream_document(WebKitWebView *webview, int op,
+        const char *request_id, const char *content, size_t length)
+{
+    struct doc_stream *ds;
+    ds = g_object_get_data(G_OBJECT(webview), DOC_STREAM_KEY);
+
+    if (op == PCRDR_K_OPERATION_WRITEBEGIN) {
+        WebKitSettings *settings = webkit_web_view_get_settings(webview);
+        if (g_object_get_data(G_OBJECT(settings), "purcmc-no-stream-write"))
+            return false;
+
+        /* a page not loaded or hidden buffers the requests */
+        if (g_object_get_data(G_OBJECT(webview), "purcmc-deferred-page"))
+            return false;
+
+        const char *page_uri = g_object_get_data(G_OBJECT(webview),
+                "purcmc-page-uri");
+        const char *load_uri = g_object_get_data(G_OBJECT(webview),
+                "purcmc-load-uri");
+        struct hvml_uri_views views;
+        if (page_uri == NULL || load_uri == NULL ||
+                !hvml_uri_split_views(page_uri, &views) ||
+                views.page.len == 0)
+            return false;
+
+        ds = doc_stream_new();
+        if (ds == NULL)
+            return false;
+
+        /* any unfinished stream is dropped; the stream lives with the
+           web view until the next one replaces it */
+        g_object_set_data_full(G_OBJECT(webview), DOC_STREAM_KEY, ds,
+                (GDestroyNotify)doc_stream_delete);
+        g_object_set_data(G_OBJECT(webview), STREAM_END_REQUEST_KEY, NULL);
+
+        /* the serial tells the load of this stream from the former ones */
+        gchar *uri = g_strdup_printf(STREAM_URI_FORMAT, page_uri,
+                ++next_stream_serial,
+                (int)views.host.len, page_uri + views.host.off,
+                (int)views.app.len, page_uri + views.app.off,
+                (int)views.runner.len, page_uri + views.runner.off,
+                (int)views.group.len, page_uri + views.group.off,
+                (int)views.page.len, page_uri + views.page.off);
+        g_object_set_data_full(G_OBJECT(webview), DOC_STREAM_URI_KEY,
+                uri, g_free);
+
+        /* the page is reloaded from `load_uri` if the stream fails */
+        struct deferred_page *deferred;
+        deferred = defer_page(webview, load_uri, NULL, false);
+        deferred->loading = true;
+
+        g_signal_handlers_disconnect_by_func(webview,
+                on_stream_load_failed, NULL);
+        g_signal_handlers_disconnect_by_func(webview,
+                on_stream_load_changed, NULL);
+        g_signal_connect(webview, "load-failed",
+                G_CALLBACK(on_stream_load_failed), NULL);
+        g_signal_connect(webview, "load-changed",
+                G_CALLBACK(on_stream_load_changed), NULL);
+        webkit_web_view_load_uri(webview, uri);
+    }
+    else if (ds == NULL) {
+        return false;
+    }
+
+    /* a stream abandoned or broken sends the chunks as requests */
+    if (!doc_stream_write(ds, content, length))
+        return false;
+
+    if (op == PCRDR_K_OPERATION_WRITEEND) {
+        doc_stream_end(ds);
+
+        /* answered once the stream is loaded */
+        g_object_set_data_full(G_OBJECT(webview), STREAM_END_REQUEST_KEY,
+                g_strdup(request_id), g_free);
+    }
+    else {
+        /* the page does not answer the other chunks fed to the stream */
+        g_object_set_data_full(G_OBJECT(webview), "purcmc-streamed-request",
+                g_strdup(request_id), g_free);
+    }
+    return true;
+}
+
 purcmc_udom *gtk_load_or_write(purcmc_session *sess, purcmc_page *page,
             int op, const char *op_name, const char* request_id,
             const char *content, size_t length,
@@ -1180,17 +2142,15 @@ purcmc_udom *gtk_load_or_write(purcmc_session *sess, purcmc_page *page,
     if (webview == NULL)
         return NULL;
 
-    char *escaped = pcutils_escape_string_for_json(content);
-    gchar *json = g_strdup_printf(PAGE_MESSAGE_FORMAT, op_name,
-            request_id, escaped ? escaped : "");
-
-    WebKitUserMessage * message = webkit_user_message_new("request",
-            g_variant_new_string(json));
-    g_free(json);
-    free(escaped);
+    if (op == PCRDR_K_OPERATION_LOAD ||
+            !stream_document(webview, op, request_id, content, length)) {
+        char *escaped = pcutils_escape_string_for_json(content);
+        gchar *json = g_strdup_printf(PAGE_MESSAGE_FORMAT, op_name,
+                request_id, escaped ? escaped : "");
+        free(escaped);
 
-    webkit_web_view_send_message_to_page(webview, message, NULL,
-            request_ready_callback, sess);
+        send_request_to_page(sess, webview, request_id, json, NULL, false);
+    }
 
     if (op == PCRDR_K_OPERATION_LOAD || op == PCRDR_K_OPERATION_WRITEBEGIN) {
         purc_page_ostack_t ostack = g_object_get_data(G_OBJECT(webview),
@@ -1266,13 +2226,14 @@ int gtk_update_dom(purcmc_session *sess, purcmc_udom *dom,
     if (escaped)
         free(escaped);
 
-    WebKitUserMessage * message = webkit_user_message_new("request",
-            g_variant_new_string(json));
-    g_free(json);
-
-    webkit_web_view_send_message_to_page(webview, message, NULL,
-            request_ready_callback, sess);
+    gchar *target = NULL;
+    if (op == PCRDR_K_OPERATION_UPDATE) {
+        target = g_strdup_printf("%s/%s/%s", element_type,
+                element_value ? element_value : "", property ? property : "");
+    }
 
+    send_request_to_page(sess, webview, request_id, json, target, false);
+    g_free(target);
     return 0;
 }
 
@@ -1331,12 +2292,8 @@ gtk_call_method_in_dom(purcmc_session *sess, const char *request_id,
     if (arg_in_json)
         free(arg_in_json);
 
-    WebKitUserMessage * message = webkit_user_message_new("request",
-            g_variant_new_string(json));
-    g_free(json);
-
-    webkit_web_view_send_message_to_page(webview, message, NULL,
-            request_ready_callback, sess);
+    /* this request needs a live DOM */
+    send_request_to_page(sess, webview, request_id, json, NULL, true);
 
     *retv = 0;
     return PURC_VARIANT_INVALID;
@@ -1402,12 +2359,8 @@ gtk_get_property_in_dom(purcmc_session *sess, const char *request_id,
     if (element_escaped)
         free(element_escaped);
 
-    WebKitUserMessage * message = webkit_user_message_new("request",
-            g_variant_new_string(json));
-    g_free(json);
-
-    webkit_web_view_send_message_to_page(webview, message, NULL,
-            request_ready_callback, sess);
+    /* this request needs a live DOM */
+    send_request_to_page(sess, webview, request_id, json, NULL, true);
 
     *retv = 0;
     return PURC_VARIANT_INVALID;
@@ -1493,12 +2446,8 @@ gtk_set_property_in_dom(purcmc_session *sess, const char *request_id,
     if (value_in_json)
         free(value_in_json);
 
-    WebKitUserMessage * message = webkit_user_message_new("request",
-            g_variant_new_string(json));
-    g_free(json);
-
-    webkit_web_view_send_message_to_page(webview, message, NULL,
-            request_ready_callback, sess);
+    /* this request needs a live DOM */
+    send_request_to_page(sess, webview, request_id, json, NULL, true);
 
     *retv = 0;
     return PURC_VARIANT_INVALID;
@@ -1580,7 +2529,12 @@ gtk_create_widget(purcmc_session *sess, purcmc_workspace *workspace,
         *retv = PCRDR_SC_PRECONDITION_FAILED;
     }
     else {
-        WebKitWebView *webview = create_web_view(sess);
+        begin_layout_batch(sess, workspace);
+
+        /* a tabbed page is deferred until it is shown */
+        WebKitWebView *webview = create_web_view(sess,
+                ws_layouter_get_page_type(workspace->layouter, group) !=
+                    WS_WIDGET_TYPE_TABBEDPAGE);
         widget = ws_layouter_add_widget(workspace->layouter, sess,
                     group, name, klass, title,
                     layout_style, toolkit_style, webview, retv);
@@ -1590,7 +2544,13 @@ gtk_create_widget(purcmc_session *sess, purcmc_workspace *workspace,
                 purc_page_ostack_new(workspace->page_owners, page_id, webview);
             g_object_set_data(G_OBJECT(webview), "purcmc-owner-stack", ostack);
 
-            web_view_load_uri(webview, sess, group, name, request_id);
+            /* do not load a tabbed page until it is shown */
+            bool deferred = !gtk_widget_get_mapped(GTK_WIDGET(webview)) &&
+                ws_layouter_retrieve_widget(workspace->layouter, widget) ==
+                    WS_WIDGET_TYPE_TABBEDPAGE;
+            web_view_load_uri(webview, sess, group, name, request_id,
+                    deferred);
+            watch_page_visibility(webview);
 
             gtk_widget_grab_focus(GTK_WIDGET(webview));
 
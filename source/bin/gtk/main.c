@@ -77,6 +77,10 @@ static gboolean enableSandbox;
 static gboolean exitAfterLoad;
 static gboolean webProcessCrashed;
 static gboolean printVersion;
+static const char *webContextPolicy;
+static int webViewPoolSize = 0;
+static int webViewPoolMax = 4;
+static gboolean noStreamWrite;
 
 GtkWidget *g_xgui_floating_window;
 
@@ -163,9 +167,21 @@ static const GOptionEntry commandLineOptions[] =
 #if HAVE(LIBSSL)
     { "pcmc-sslcert", 0, 0, G_OPTION_ARG_STRING, &pcmc_srvcfg.sslcert, "The path to SSL certificate", "FILE" },
     { "pcmc-sslkey", 0, 0, G_OPTION_ARG_STRING, &pcmc_srvcfg.sslkey, "The path to SSL private key", "FILE" },
+    { "pcmc-tlsworkers", 0, 0, G_OPTION_ARG_INT, &pcmc_srvcfg.tls_workers, "The number of threads doing TLS handshakes (-1 for the main thread)", "NUMBER" },
+    { "pcmc-notlstickets", 0, 0, G_OPTION_ARG_NONE, &pcmc_srvcfg.notlstickets, "Without support for TLS session tickets", NULL },
 #endif
     { "pcmc-maxfrmsize", 0, 0, G_OPTION_ARG_INT, &pcmc_srvcfg.max_frm_size, "The maximum size of a socket frame", "BYTES" },
     { "pcmc-backlog", 0, 0, G_OPTION_ARG_INT, &pcmc_srvcfg.backlog, "The maximum length to which the queue of pending connections.", "NUMBER" },
+#if HAVE(ZLIB)
+    { "pcmc-nodeflate", 0, 0, G_OPTION_ARG_NONE, &pcmc_srvcfg.nodeflate, "Without support for the permessage-deflate extension of WebSocket", NULL },
+    { "pcmc-deflate-wbits", 0, 0, G_OPTION_ARG_INT, &pcmc_srvcfg.deflate_wbits, "The maximal window bits (9~15) used to compress WebSocket messages", "BITS" },
+    { "pcmc-deflate-minsize", 0, 0, G_OPTION_ARG_INT, &pcmc_srvcfg.deflate_min_size, "The minimal size of a WebSocket message to compress", "BYTES" },
+    { "pcmc-deflate-noctx", 0, 0, G_OPTION_ARG_NONE, &pcmc_srvcfg.deflate_no_ctx_takeover, "Do not take over the compression context between WebSocket messages", NULL },
+#endif
+    { "pcmc-webcontext", 0, 0, G_OPTION_ARG_STRING, &webContextPolicy, "The web context used by the sessions (session, app, or pool:N). Default: session", "POLICY" },
+    { "pcmc-webview-pool", 0, 0, G_OPTION_ARG_INT, &webViewPoolSize, "The number of web views pre-created for each shared web context (0 to disable). Default: 0", "NUMBER" },
+    { "pcmc-webview-pool-max", 0, 0, G_OPTION_ARG_INT, &webViewPoolMax, "The maximum number of idle pre-created web views in total. Default: 4", "NUMBER" },
+    { "pcmc-nostreamwrite", 0, 0, G_OPTION_ARG_NONE, &noStreamWrite, "Write documents by document.write() in the page instead of streaming them to WebKit", NULL },
 
 #if WEBKIT_CHECK_VERSION(2, 30, 0)
     { "autoplay-policy", 0, 0, G_OPTION_ARG_CALLBACK, parseAutoplayPolicy, "Autoplay policy. Valid options are: allow, allow-without-sound, and deny", NULL },
@@ -756,6 +772,14 @@ static void startup(GApplication *application, WebKitSettings *webkitSettings)
 
     /* use webkitSettings to store some global data */
     g_object_set_data(G_OBJECT(webkitSettings), "gtk-application", application);
+    g_object_set_data(G_OBJECT(webkitSettings), "purcmc-webcontext-policy",
+            (gpointer)webContextPolicy);
+    g_object_set_data(G_OBJECT(webkitSettings), "purcmc-webview-pool-size",
+            GUINT_TO_POINTER(MAX(webViewPoolSize, 0)));
+    g_object_set_data(G_OBJECT(webkitSettings), "purcmc-webview-pool-max",
+            GUINT_TO_POINTER(MAX(webViewPoolMax, 0)));
+    g_object_set_data(G_OBJECT(webkitSettings), "purcmc-no-stream-write",
+            GINT_TO_POINTER(noStreamWrite));
     setDefaultWebsiteDataManager(webkitSettings);
 #if WEBKIT_CHECK_VERSION(2, 30, 0)
     setDefaultWebsitePolicies(webkitSettings);
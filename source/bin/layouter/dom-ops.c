@@ -22,13 +22,167 @@
 
 #include "dom-ops.h"
 
-#include "utils/sorted-array.h"
-
 #include <purc/purc-helpers.h>
 
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
-#define SA_INITIAL_SIZE        8
+/*
+ * The map from identifiers to elements: an open-addressing hash table with
+ * linear probing. The keys are the values of the `id` attributes owned by
+ * the DOM, so an entry must be removed before the element is destroyed.
+ * Like before, the first one wins if there are elements with the same
+ * identifier.
+ */
+#define ID_MAP_INITIAL_SIZE     16
+
+struct id_map_entry {
+    const char      *id;    /* NULL for an empty slot */
+    uint32_t        hash;
+    uint32_t        len;
+    pcdom_element_t *element;
+};
+
+struct id_map {
+    size_t              capacity;   /* always a power of 2 */
+    size_t              count;
+    struct id_map_entry *entries;
+};
+
+static inline uint32_t id_map_hash(const char *id, size_t len)
+{
+    /* FNV-1a */
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)id[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static struct id_map *id_map_new(void)
+{
+    struct id_map *map = malloc(sizeof(*map));
+    if (map) {
+        map->capacity = ID_MAP_INITIAL_SIZE;
+        map->count = 0;
+        map->entries = calloc(map->capacity, sizeof(struct id_map_entry));
+        if (map->entries == NULL) {
+            free(map);
+            map = NULL;
+        }
+    }
+
+    return map;
+}
+
+static void id_map_delete(struct id_map *map)
+{
+    free(map->entries);
+    free(map);
+}
+
+/* Returns the slot of the identifier, or the empty slot to store it. */
+static size_t id_map_lookup(struct id_map *map, const char *id, size_t len,
+        uint32_t hash)
+{
+    size_t mask = map->capacity - 1;
+    size_t idx = hash & mask;
+
+    while (map->entries[idx].id) {
+        struct id_map_entry *entry = map->entries + idx;
+        if (entry->hash == hash && entry->len == len &&
+                memcmp(entry->id, id, len) == 0)
+            break;
+
+        idx = (idx + 1) & mask;
+    }
+
+    return idx;
+}
+
+static bool id_map_grow(struct id_map *map)
+{
+    struct id_map_entry *old_entries = map->entries;
+    size_t old_capacity = map->capacity;
+
+    map->entries = calloc(old_capacity * 2, sizeof(struct id_map_entry));
+    if (map->entries == NULL) {
+        map->entries = old_entries;
+        return false;
+    }
+
+    map->capacity = old_capacity * 2;
+    for (size_t i = 0; i < old_capacity; i++) {
+        struct id_map_entry *entry = old_entries + i;
+        if (entry->id) {
+            size_t idx = id_map_lookup(map, entry->id, entry->len,
+                    entry->hash);
+            map->entries[idx] = *entry;
+        }
+    }
+
+    free(old_entries);
+    return true;
+}
+
+static int id_map_add(struct id_map *map, const char *id, size_t len,
+        pcdom_element_t *element)
+{
+    /* keep the load factor under 3/4 */
+    if ((map->count + 1) * 4 > map->capacity * 3 && !id_map_grow(map))
+        return -3;
+
+    uint32_t hash = id_map_hash(id, len);
+    size_t idx = id_map_lookup(map, id, len, hash);
+    struct id_map_entry *entry = map->entries + idx;
+    if (entry->id)
+        return -1;
+
+    entry->id = id;
+    entry->hash = hash;
+    entry->len = (uint32_t)len;
+    entry->element = element;
+    map->count++;
+    return 0;
+}
+
+static bool id_map_remove(struct id_map *map, const char *id, size_t len)
+{
+    size_t mask = map->capacity - 1;
+    size_t idx = id_map_lookup(map, id, len, id_map_hash(id, len));
+
+    if (map->entries[idx].id == NULL)
+        return false;
+
+    /* shift the following entries of the cluster back; no tombstones */
+    size_t next = idx;
+    for (;;) {
+        next = (next + 1) & mask;
+        if (map->entries[next].id == NULL)
+            break;
+
+        size_t home = map->entries[next].hash & mask;
+        /* move it only if its home slot is not in (idx, next] */
+        if (((next - home) & mask) >= ((next - idx) & mask)) {
+            map->entries[idx] = map->entries[next];
+            idx = next;
+        }
+    }
+
+    map->entries[idx].id = NULL;
+    map->count--;
+    return true;
+}
+
+static pcdom_element_t *id_map_find(struct id_map *map,
+        const char *id, size_t len)
+{
+    size_t idx = id_map_lookup(map, id, len, id_map_hash(id, len));
+    return map->entries[idx].id ? map->entries[idx].element : NULL;
+}
 
 static const char *get_element_id(pcdom_element_t *element, size_t *sz)
 {
@@ -49,7 +203,7 @@ static const char *get_element_id(pcdom_element_t *element, size_t *sz)
 struct my_tree_walker_ctxt {
     bool mark_dirty;
     bool add_or_remove;
-    struct sorted_array *sa;
+    struct id_map *map;
 };
 
 static pchtml_action_t
@@ -57,6 +211,7 @@ my_tree_walker(pcdom_node_t *node, void *ctx)
 {
     struct my_tree_walker_ctxt *ctxt = ctx;
     const char *id;
+    size_t len;
 
     switch (node->type) {
     case PCDOM_NODE_TYPE_DOCUMENT_TYPE:
@@ -68,15 +223,16 @@ my_tree_walker(pcdom_node_t *node, void *ctx)
         return PCHTML_ACTION_NEXT;
 
     case PCDOM_NODE_TYPE_ELEMENT:
-        id = get_element_id(pcdom_interface_element(node), NULL);
+        id = get_element_id(pcdom_interface_element(node), &len);
         if (id) {
             if (ctxt->add_or_remove) {
-                if (sorted_array_add(ctxt->sa, PTR2U64(id), node)) {
+                if (id_map_add(ctxt->map, id, len,
+                            pcdom_interface_element(node))) {
                     purc_log_warn("Failed to store id/element pair\n");
                 }
             }
             else {
-                if (!sorted_array_remove(ctxt->sa, PTR2U64(id))) {
+                if (!id_map_remove(ctxt->map, id, len)) {
                     purc_log_warn("Failed to remove id/element pair\n");
                 }
             }
@@ -100,35 +256,25 @@ my_tree_walker(pcdom_node_t *node, void *ctx)
     return PCHTML_ACTION_NEXT;
 }
 
-static int
-sa_string_cmp(uint64_t sortv1, uint64_t sortv2)
-{
-    const char *str1 = (void *)(uintptr_t)sortv1;
-    const char *str2 = (void *)(uintptr_t)sortv2;
-
-    return strcmp(str1, str2);
-}
-
 static bool
 dom_build_id_element_map(pcdom_document_t *dom_doc)
 {
-    struct sorted_array *sa;
+    struct id_map *map;
 
     assert(dom_doc->user == NULL);
-    sa = sorted_array_create(SAFLAG_DEFAULT, SA_INITIAL_SIZE, NULL,
-            sa_string_cmp);
-    if (sa == NULL) {
+    map = id_map_new();
+    if (map == NULL) {
         return false;
     }
 
     struct my_tree_walker_ctxt ctxt = {
         .mark_dirty     = false,
         .add_or_remove  = true,
-        .sa             = sa,
+        .map            = map,
     };
 
     pcdom_node_simple_walk(&dom_doc->node, my_tree_walker, &ctxt);
-    dom_doc->user = sa;
+    dom_doc->user = map;
     return true;
 }
 
@@ -139,7 +285,7 @@ dom_destroy_id_element_map(pcdom_document_t *dom_doc)
         return false;
     }
 
-    sorted_array_destroy(dom_doc->user);
+    id_map_delete(dom_doc->user);
     dom_doc->user = NULL;
     return true;
 }
@@ -147,11 +293,7 @@ dom_destroy_id_element_map(pcdom_document_t *dom_doc)
 pcdom_element_t *
 dom_get_element_by_id(pcdom_document_t *dom_doc, const char *id)
 {
-    void* data;
-    if (sorted_array_find(dom_doc->user, PTR2U64(id), &data))
-        return (pcdom_element_t *)data;
-
-    return NULL;
+    return id_map_find(dom_doc->user, id, strlen(id));
 }
 
 bool dom_prepare_id_map(pcdom_document_t *dom_doc)
@@ -176,6 +318,15 @@ bool dom_cleanup_id_map(pcdom_document_t *dom_doc)
     return true;
 }
 
+void
+dom_mark_dirty(pcdom_node_t *node)
+{
+    while (node && node->type == PCDOM_NODE_TYPE_ELEMENT) {
+        node->flags |= NF_DIRTY;
+        node = node->parent;
+    }
+}
+
 static bool
 dom_merge_id_element_map(pcdom_document_t *dom_doc, pcdom_node_t *subtree)
 {
@@ -184,7 +335,7 @@ dom_merge_id_element_map(pcdom_document_t *dom_doc, pcdom_node_t *subtree)
     struct my_tree_walker_ctxt ctxt = {
         .mark_dirty     = true,
         .add_or_remove  = true,
-        .sa             = dom_doc->user,
+        .map            = dom_doc->user,
     };
 
     pcdom_node_simple_walk(subtree, my_tree_walker, &ctxt);
@@ -199,7 +350,7 @@ dom_subtract_id_element_map(pcdom_document_t *dom_doc, pcdom_node_t *subtree)
     struct my_tree_walker_ctxt ctxt = {
         .mark_dirty     = false,
         .add_or_remove  = false,
-        .sa             = dom_doc->user,
+        .map            = dom_doc->user,
     };
 
     pcdom_node_simple_walk(subtree, my_tree_walker, &ctxt);
@@ -251,6 +402,7 @@ dom_append_subtree_to_element(pcdom_document_t *dom_doc,
         div = subtree->first_child;
 
         dom_merge_id_element_map(dom_doc, div);
+        dom_mark_dirty(parent);
         while (div->first_child) {
             pcdom_node_t *child = div->first_child;
             pcdom_node_remove(child);
@@ -273,6 +425,7 @@ dom_prepend_subtree_to_element(pcdom_document_t *dom_doc,
         div = subtree->first_child;
 
         dom_merge_id_element_map(dom_doc, div);
+        dom_mark_dirty(parent);
         while (div->last_child) {
             pcdom_node_t *child = div->last_child;
             pcdom_node_remove(child);
@@ -295,6 +448,7 @@ dom_insert_subtree_before_element(pcdom_document_t *dom_doc,
         div = subtree->first_child;
 
         dom_merge_id_element_map(dom_doc, div);
+        dom_mark_dirty(to->parent);
         while (div->last_child) {
             pcdom_node_t *child = div->last_child;
             pcdom_node_remove(child);
@@ -317,6 +471,7 @@ dom_insert_subtree_after_element(pcdom_document_t *dom_doc,
         div = subtree->first_child;
 
         dom_merge_id_element_map(dom_doc, div);
+        dom_mark_dirty(to->parent);
         while (div->first_child) {
             pcdom_node_t *child = div->first_child;
             pcdom_node_remove(child);
@@ -344,6 +499,7 @@ dom_displace_subtree_of_element(pcdom_document_t *dom_doc,
         div = subtree->first_child;
 
         dom_merge_id_element_map(dom_doc, div);
+        dom_mark_dirty(parent);
         while (div->first_child) {
             pcdom_node_t *child = div->first_child;
             pcdom_node_remove(child);
@@ -365,23 +521,18 @@ void
 dom_erase_element(pcdom_document_t *dom_doc, pcdom_element_t *element)
 {
     pcdom_node_t *node = pcdom_interface_node(element);
-    const char *id;
 
+    /* the walker also removes the identifier of the element itself */
+    dom_mark_dirty(node->parent);
     dom_subtract_id_element_map(dom_doc, node);
     pcdom_node_destroy_deep(node);
-
-    id = get_element_id(element, NULL);
-    if (id) {
-        if (!sorted_array_remove(dom_doc->user, PTR2U64(id))) {
-            purc_log_warn("Failed to store id/element pair\n");
-        }
-    }
 }
 
 void
 dom_clear_element(pcdom_document_t *dom_doc, pcdom_element_t *element)
 {
     pcdom_node_t *parent = pcdom_interface_node(element);
+    dom_mark_dirty(parent);
     dom_subtract_id_element_map(dom_doc, parent);
     while (parent->first_child != NULL) {
         pcdom_node_destroy_deep(parent->first_child);
@@ -420,6 +571,8 @@ dom_update_element(pcdom_document_t *dom_doc, pcdom_element_t *element,
         retv = false;
     }
 
+    if (retv)
+        dom_mark_dirty(pcdom_interface_node(element));
     return retv;
 }
 
@@ -438,6 +591,8 @@ dom_remove_element_property(pcdom_document_t *dom_doc, pcdom_element_t *element,
             retv = true;
     }
 
+    if (retv)
+        dom_mark_dirty(pcdom_interface_node(element));
     return retv;
 }
 
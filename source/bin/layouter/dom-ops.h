@@ -35,6 +35,9 @@
 extern "C" {
 #endif
 
+/* mark the node and all of its ancestor elements as dirty */
+void dom_mark_dirty(pcdom_node_t *node);
+
 bool dom_prepare_id_map(pcdom_document_t *dom_doc);
 
 bool dom_cleanup_id_map(pcdom_document_t *dom_doc);
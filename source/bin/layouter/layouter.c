@@ -41,6 +41,16 @@ struct ws_layouter {
 
     struct sorted_array *sa_widget;
 
+    /* widget -> the geometry applied last time */
+    struct sorted_array *sa_geometry;
+
+    struct ws_layouter_stats stats;
+
+    /* the nesting depth of batches; relayout is deferred if not zero */
+    unsigned batch_depth;
+    /* the DOM changed since the boxes were computed last time */
+    bool boxes_stale;
+
     void *workspace;
     wsltr_convert_style_fn cb_convert_style;
     wsltr_create_widget_fn cb_create_widget;
@@ -48,6 +58,26 @@ struct ws_layouter {
     wsltr_update_widget_fn cb_update_widget;
 };
 
+/* The geometry part of `struct ws_widget_info` applied last time;
+   all fields are 4-byte wide, so there is no padding to compare. */
+struct widget_geometry {
+    int         x, y;
+    unsigned    w, h;
+
+    int         ml, mt, mr, mb;
+    int         pl, pt, pr, pb;
+    float       bl, bt, br, bb;
+    float       brlt, brtr, brrb, brbl;
+
+    float       opacity;
+};
+
+static void free_geometry(uint64_t sortv, void *data)
+{
+    (void)sortv;
+    free(data);
+}
+
 static inline pcdom_element_t *
 find_section_ancestor(pcdom_element_t *element)
 {
@@ -140,6 +170,65 @@ fill_position(struct ws_widget_info *style, const HLBox *box,
     style->opacity = box->opacity;
 }
 
+static void fill_geometry(struct widget_geometry *geometry,
+        const struct ws_widget_info *style)
+{
+    geometry->x = style->x;
+    geometry->y = style->y;
+    geometry->w = style->w;
+    geometry->h = style->h;
+
+    geometry->ml = style->ml;
+    geometry->mt = style->mt;
+    geometry->mr = style->mr;
+    geometry->mb = style->mb;
+
+    geometry->pl = style->pl;
+    geometry->pt = style->pt;
+    geometry->pr = style->pr;
+    geometry->pb = style->pb;
+
+    geometry->bl = style->bl;
+    geometry->bt = style->bt;
+    geometry->br = style->br;
+    geometry->bb = style->bb;
+
+    geometry->brlt = style->brlt;
+    geometry->brtr = style->brtr;
+    geometry->brrb = style->brrb;
+    geometry->brbl = style->brbl;
+
+    geometry->opacity = style->opacity;
+}
+
+/* Remember the geometry of a widget; returns false if it is not changed. */
+static bool cache_geometry(struct ws_layouter *layouter, void *widget,
+        const struct ws_widget_info *style)
+{
+    struct widget_geometry geometry;
+    void *data;
+
+    fill_geometry(&geometry, style);
+    if (sorted_array_find(layouter->sa_geometry, PTR2U64(widget), &data)) {
+        if (memcmp(data, &geometry, sizeof(geometry)) == 0)
+            return false;
+
+        memcpy(data, &geometry, sizeof(geometry));
+        return true;
+    }
+
+    data = malloc(sizeof(geometry));
+    if (data) {
+        memcpy(data, &geometry, sizeof(geometry));
+        if (sorted_array_add(layouter->sa_geometry, PTR2U64(widget), data)) {
+            purc_log_warn("Failed to cache geometry of widget %p\n", widget);
+            free(data);
+        }
+    }
+
+    return true;
+}
+
 static void get_element_name_title(pcdom_element_t *element,
         char **name, char **title, char **klass, char **level)
 {
@@ -212,6 +301,8 @@ static void calc_offsets(struct ws_layouter *layouter, pcdom_node_t *node,
     }
 }
 
+static int layout_boxes(struct ws_layouter *layouter);
+
 #define ANONYMOUS_NAME      "annoymous"
 #define UNTITLED            "Untitled"
 
@@ -220,26 +311,38 @@ static void *create_widget_for_element(struct ws_layouter *layouter,
         void *session, void *window, void *container, void *init_arg,
         purc_variant_t toolkit_style)
 {
-    const HLBox *box;
-    box = domruler_get_node_bounding_box(layouter->ruler,
-            pcdom_interface_node(element));
-    if (box == NULL) {
-        purc_log_error("Cannot get bounding box for element\n");
-        return NULL;
+    /* in a batch, the widget is created without a geometry if the boxes
+       are stale; its geometry is set when the batch is committed */
+    bool provisional = layouter->boxes_stale && layouter->batch_depth > 0;
+
+    const HLBox *box = NULL;
+    if (!provisional) {
+        if (layouter->boxes_stale && layout_boxes(layouter) != PCRDR_SC_OK)
+            return NULL;
+
+        box = domruler_get_node_bounding_box(layouter->ruler,
+                pcdom_interface_node(element));
+        if (box == NULL) {
+            purc_log_error("Cannot get bounding box for element\n");
+            return NULL;
+        }
     }
 
     char *name, *title, *klass, *level;
     get_element_name_title(element, &name, &title, &klass, &level);
 
     struct ws_widget_info style = { 0, 0, 0, 0 };
-    style.flags = WSWS_FLAG_NAME | WSWS_FLAG_GEOMETRY;
+    style.flags = WSWS_FLAG_NAME;
     style.name = name ? name : ANONYMOUS_NAME;
     style.title = title ? title: UNTITLED;
     style.klass = klass ? klass: NULL;
     style.level = level ? level : NULL;
-    float off_x, off_y;
-    calc_offsets(layouter, pcdom_interface_node(element), &off_x, &off_y);
-    fill_position(&style, box, off_x, off_y);
+    if (box) {
+        float off_x, off_y;
+        calc_offsets(layouter, pcdom_interface_node(element), &off_x, &off_y);
+        fill_position(&style, box, off_x, off_y);
+        style.flags |= WSWS_FLAG_GEOMETRY;
+    }
     layouter->cb_convert_style(&style, toolkit_style);
 
     void *widget = layouter->cb_create_widget(layouter->workspace, session,
@@ -269,6 +372,12 @@ static void *create_widget_for_element(struct ws_layouter *layouter,
                 widget, element);
     }
 
+    /* the widget was created with this geometry */
+    if (box)
+        cache_geometry(layouter, widget, &style);
+    else
+        dom_mark_dirty(pcdom_interface_node(element));
+
     return widget;
 }
 
@@ -401,6 +510,7 @@ static bool destroy_widget_for_element(struct ws_layouter *layouter,
 
     if (widget && window) {
         sorted_array_remove(layouter->sa_widget, PTR2U64(widget));
+        sorted_array_remove(layouter->sa_geometry, PTR2U64(widget));
 
         ws_widget_type_t type;
         type = get_widget_type_from_element(element);
@@ -467,6 +577,30 @@ append_style_walker(pcdom_node_t *node, void *ctxt)
     return PCHTML_ACTION_OK;
 }
 
+/* The contents of the default CSS file are loaded once and shared by all
+   layouters; each layouter still parses them in its own ruler. */
+static struct layouter_cache {
+    char           *def_css;
+    size_t          len_def_css;
+} ltr_cache;
+
+static const char *get_default_css(size_t *len)
+{
+    if (ltr_cache.def_css == NULL) {
+        ltr_cache.def_css = load_asset_content("WEBKIT_WEBEXT_DIR",
+                WEBKIT_WEBEXT_DIR, DEF_LAYOUT_CSS, &ltr_cache.len_def_css, 0);
+    }
+
+    *len = ltr_cache.len_def_css;
+    return ltr_cache.def_css;
+}
+
+void ws_layouter_cleanup_cache(void)
+{
+    free(ltr_cache.def_css);
+    memset(&ltr_cache, 0, sizeof(ltr_cache));
+}
+
 static void append_css_in_style_element(struct ws_layouter *layouter)
 {
     pcdom_element_t *head = pchtml_doc_get_head(layouter->dom_doc);
@@ -476,8 +610,7 @@ static void append_css_in_style_element(struct ws_layouter *layouter)
 }
 
 static int
-relayout(struct ws_layouter *layouter, void *session,
-        pcdom_element_t *subtree_root);
+relayout(struct ws_layouter *layouter, void *session);
 
 struct ws_layouter *ws_layouter_new(struct ws_metrics *metrics,
         const char *html_contents, size_t sz_html_contents, void *workspace,
@@ -499,6 +632,13 @@ struct ws_layouter *ws_layouter_new(struct ws_metrics *metrics,
         goto failed;
     }
 
+    layouter->sa_geometry = sorted_array_create(SAFLAG_DEFAULT,
+            SA_INITIAL_SIZE, free_geometry, NULL);
+    if (layouter->sa_geometry == NULL) {
+        *retv = PCRDR_SC_INSUFFICIENT_STORAGE;
+        goto failed;
+    }
+
     layouter->ruler = domruler_create(metrics->width,
             metrics->height, metrics->dpi, metrics->density);
     if (layouter->ruler == NULL) {
@@ -506,13 +646,11 @@ struct ws_layouter *ws_layouter_new(struct ws_metrics *metrics,
         goto failed;
     }
 
-    char *def_css;
+    const char *def_css;
     size_t len_def_css;
-    def_css = load_asset_content("WEBKIT_WEBEXT_DIR", WEBKIT_WEBEXT_DIR,
-                DEF_LAYOUT_CSS, &len_def_css, 0);
+    def_css = get_default_css(&len_def_css);
     if (def_css) {
         domruler_append_css(layouter->ruler, def_css, len_def_css);
-        free(def_css);
     }
     else {
         purc_log_warn("Failed to load default CSS from: %s\n", DEF_LAYOUT_CSS);
@@ -552,12 +690,17 @@ struct ws_layouter *ws_layouter_new(struct ws_metrics *metrics,
     layouter->cb_create_widget = cb_create_widget;
     layouter->cb_destroy_widget = cb_destroy_widget;
     layouter->cb_update_widget = cb_update_widget;
-    *retv = relayout(layouter, NULL, pchtml_doc_get_body(layouter->dom_doc));
+
+    /* the initial layout */
+    dom_mark_dirty(pcdom_interface_node(body));
+    *retv = relayout(layouter, NULL);
     return layouter;
 
 failed:
     if (layouter->sa_widget)
         sorted_array_destroy(layouter->sa_widget);
+    if (layouter->sa_geometry)
+        sorted_array_destroy(layouter->sa_geometry);
     if (layouter->ruler)
         domruler_destroy(layouter->ruler);
     if (layouter->dom_doc) {
@@ -586,8 +729,14 @@ void ws_layouter_delete(struct ws_layouter *layouter, void *sess)
     pcdom_node_t *node = pcdom_interface_node(body);
     pcdom_node_simple_walk(node, destroy_widget_walker, &ctxt);
     purc_log_info("destroyed windows: %u\n", ctxt.nr_destroyed);
+    purc_log_info("relayouts: %lu; box layouts: %lu; "
+            "geometry updates applied: %lu, suppressed: %lu\n",
+            layouter->stats.nr_relayouts, layouter->stats.nr_box_layouts,
+            layouter->stats.nr_geometry_applied,
+            layouter->stats.nr_geometry_suppressed);
 
     sorted_array_destroy(layouter->sa_widget);
+    sorted_array_destroy(layouter->sa_geometry);
     domruler_destroy(layouter->ruler);
     dom_cleanup_id_map(pcdom_interface_document(layouter->dom_doc));
     pchtml_html_document_destroy(layouter->dom_doc);
@@ -610,6 +759,7 @@ int ws_layouter_add_widget_groups(struct ws_layouter *layouter,
 
         if (is_an_element_with_tag(section, "SECTION")) {
             dom_append_subtree_to_element(doc, body, subtree);
+            layouter->boxes_stale = true;
             return PCRDR_SC_OK;
         }
         else {
@@ -661,95 +811,151 @@ destroy_widget_walker(pcdom_node_t *node, void *ctxt)
 struct relayout_widget_ctxt {
     struct ws_layouter *layouter;
     void *session;
-    void *container;
 
     unsigned nr_laid;
     unsigned nr_ignored;
     unsigned nr_error;
 };
 
-static pchtml_action_t
-layout_widget_walker(pcdom_node_t *node, void *ctxt)
+/* Returns true if the geometry of the widget changed. */
+static bool
+update_widget_geometry(struct relayout_widget_ctxt *ctxt, pcdom_node_t *node)
 {
-    switch (node->type) {
-    case PCDOM_NODE_TYPE_DOCUMENT_TYPE:
-        return PCHTML_ACTION_NEXT;
+    struct ws_layouter *layouter = ctxt->layouter;
+    const HLBox *box;
 
-    case PCDOM_NODE_TYPE_TEXT:
-    case PCDOM_NODE_TYPE_COMMENT:
-    case PCDOM_NODE_TYPE_CDATA_SECTION:
-        return PCHTML_ACTION_NEXT;
+    box = domruler_get_node_bounding_box(layouter->ruler, node);
+    if (box == NULL) {
+        ctxt->nr_error++;
+        return false;
+    }
 
-    case PCDOM_NODE_TYPE_ELEMENT:
-    {
-        struct relayout_widget_ctxt *my_ctxt = ctxt;
-        if (node->user) {
+    struct ws_widget_info style = { 0 };
+    float off_x, off_y;
+    calc_offsets(layouter, node, &off_x, &off_y);
+    fill_position(&style, box, off_x, off_y);
 
-            const HLBox *box;
-            box = domruler_get_node_bounding_box(my_ctxt->layouter->ruler,
-                    node);
+    if (!cache_geometry(layouter, node->user, &style)) {
+        layouter->stats.nr_geometry_suppressed++;
+        ctxt->nr_ignored++;
+        return false;
+    }
 
-            if (box) {
-                struct ws_widget_info style = { 0 };
+    ws_widget_type_t type;
+    type = get_widget_type_from_element(pcdom_interface_element(node));
+
+    style.flags = WSWS_FLAG_GEOMETRY;
+    layouter->cb_update_widget(layouter->workspace, ctxt->session,
+            node->user, type, &style);
+    layouter->stats.nr_geometry_applied++;
+    ctxt->nr_laid++;
+    return true;
+}
 
-                style.flags = WSWS_FLAG_GEOMETRY;
-                float off_x, off_y;
-                calc_offsets(my_ctxt->layouter, node, &off_x, &off_y);
-                fill_position(&style, box, off_x, off_y);
+/*
+ * Only the dirty subtrees and the subtrees of the widgets whose geometry
+ * changed are visited. The children of an element which is not a widget
+ * are always visited, because we do not know whether it moved or not.
+ */
+static void
+relayout_children(struct relayout_widget_ctxt *ctxt, pcdom_node_t *parent)
+{
+    pcdom_node_t *node = parent->first_child;
 
-                ws_widget_type_t type;
-                pcdom_element_t *element = pcdom_interface_element(node);
-                type = get_widget_type_from_element(element);
+    while (node) {
+        if (node->type == PCDOM_NODE_TYPE_ELEMENT) {
+            bool descend = (node->flags & NF_DIRTY) || node->user == NULL;
 
-                my_ctxt->layouter->cb_update_widget(
-                        my_ctxt->layouter->workspace, my_ctxt->session,
-                        node->user, type, &style);
-                my_ctxt->nr_laid++;
-            }
-            else {
-                my_ctxt->nr_error++;
-            }
-        }
+            node->flags &= ~NF_DIRTY;
+            if (node->user && update_widget_geometry(ctxt, node))
+                descend = true;
 
-        if (node->first_child != NULL) {
-            my_ctxt->container = node->user;
-            return PCHTML_ACTION_OK;
+            if (descend && node->first_child)
+                relayout_children(ctxt, node);
         }
 
-        /* walk to the siblings. */
-        return PCHTML_ACTION_NEXT;
-    }
-
-    default:
-        /* ignore any unknown node types */
-        break;
+        node = node->next;
     }
-
-    return PCHTML_ACTION_NEXT;
 }
 
-static int
-relayout(struct ws_layouter *layouter, void *session,
-        pcdom_element_t *subtree_root)
+/* domruler has no incremental entry point: the boxes of the whole
+   document are computed again, only the widget updates are narrowed. */
+static int layout_boxes(struct ws_layouter *layouter)
 {
     pcdom_document_t *dom_doc = pcdom_interface_document(layouter->dom_doc);
-    pcdom_element_t *root = dom_doc->element;
 
     domruler_reset_nodes(layouter->ruler);
-    int ret = domruler_layout_pcdom_elements(layouter->ruler, root);
+    int ret = domruler_layout_pcdom_elements(layouter->ruler,
+            dom_doc->element);
     if (ret) {
         purc_log_error("Failed to re-layout the widgets: %d.\n", ret);
         return PCRDR_SC_INTERNAL_SERVER_ERROR;
     }
 
-    if (subtree_root == NULL) {
-        subtree_root = root;
+    layouter->boxes_stale = false;
+    layouter->stats.nr_box_layouts++;
+    return PCRDR_SC_OK;
+}
+
+static void update_dirty_widgets(struct ws_layouter *layouter, void *session)
+{
+    pcdom_document_t *dom_doc = pcdom_interface_document(layouter->dom_doc);
+    pcdom_node_t *root = pcdom_interface_node(dom_doc->element);
+
+    if (!(root->flags & NF_DIRTY))
+        return;
+
+    struct relayout_widget_ctxt ctxt = { layouter, session, 0, 0, 0 };
+    layouter->stats.nr_relayouts++;
+    root->flags &= ~NF_DIRTY;
+    relayout_children(&ctxt, root);
+
+    purc_log_debug("Relayout: %u widget(s) updated, %u unchanged, %u error(s)\n",
+            ctxt.nr_laid, ctxt.nr_ignored, ctxt.nr_error);
+}
+
+static int
+relayout(struct ws_layouter *layouter, void *session)
+{
+    pcdom_document_t *dom_doc = pcdom_interface_document(layouter->dom_doc);
+    pcdom_node_t *root = pcdom_interface_node(dom_doc->element);
+
+    /* nothing changed since the last layout */
+    if (!(root->flags & NF_DIRTY))
+        return PCRDR_SC_OK;
+
+    /* deferred to ws_layouter_commit() */
+    if (layouter->batch_depth > 0) {
+        layouter->boxes_stale = true;
+        return PCRDR_SC_OK;
     }
 
-    pcdom_node_t *node = pcdom_interface_node(subtree_root);
-    struct relayout_widget_ctxt ctxt = { layouter, session, node->user,
-        0, 0, 0, };
-    pcdom_node_simple_walk(node, layout_widget_walker, &ctxt);
+    int ret = layout_boxes(layouter);
+    if (ret != PCRDR_SC_OK)
+        return ret;
+
+    update_dirty_widgets(layouter, session);
+    return PCRDR_SC_OK;
+}
+
+void ws_layouter_begin_batch(struct ws_layouter *layouter)
+{
+    layouter->batch_depth++;
+}
+
+int ws_layouter_commit(struct ws_layouter *layouter, void *session)
+{
+    assert(layouter->batch_depth > 0);
+
+    if (--layouter->batch_depth > 0)
+        return PCRDR_SC_OK;
+
+    /* lay out the boxes once for all the widgets changed or created in
+       the batch, and set the geometry of the new ones */
+    if (layouter->boxes_stale)
+        return relayout(layouter, session);
+
+    update_dirty_widgets(layouter, session);
     return PCRDR_SC_OK;
 }
 
@@ -771,12 +977,10 @@ int ws_layouter_remove_widget_group(struct ws_layouter *layouter,
 
         purc_log_info("Totatlly %u widget(s) destroyed.\n", ctxt.nr_destroyed);
 
-        pcdom_element_t *section = find_section_ancestor(element);
-
         dom_erase_element(dom_doc, element);
 
         if (ctxt.nr_destroyed > 0) {
-            relayout(layouter, session, section);
+            relayout(layouter, session);
         }
         return PCRDR_SC_OK;
     }
@@ -848,7 +1052,7 @@ void *ws_layouter_add_plain_window(struct ws_layouter *layouter,
             assert(has_tag(figure, "FIGURE"));
 
             /* re-layout the exsiting widgets */
-            relayout(layouter, session, section);
+            relayout(layouter, session);
 
             if ((widget = create_widget_for_element(layouter, figure,
                     WS_WIDGET_TYPE_PLAINWINDOW, session, NULL, NULL, init_arg,
@@ -881,11 +1085,9 @@ int ws_layouter_remove_plain_window_by_id(struct ws_layouter *layouter,
 
     /* the element must be a `figure` element */
     if (element && has_tag(element, "FIGURE")) {
-        pcdom_element_t *section = find_section_ancestor(element);
-
         destroy_widget_for_element(layouter, session, element);
         dom_erase_element(dom_doc, element);
-        relayout(layouter, session, section);
+        relayout(layouter, session);
 
         return PCRDR_SC_OK;
     }
@@ -905,11 +1107,9 @@ int ws_layouter_remove_plain_window_by_handle(struct ws_layouter *layouter,
 
         /* the element must be a `figure` element */
         if (has_tag(element, "FIGURE")) {
-            pcdom_element_t *section = find_section_ancestor(element);
-
             destroy_widget_for_element(layouter, session, element);
             dom_erase_element(dom_doc, element);
-            relayout(layouter, session, section);
+            relayout(layouter, session);
 
             return PCRDR_SC_OK;
         }
@@ -999,6 +1199,28 @@ static void *create_tabbed_window(struct ws_layouter *layouter, void *session,
     return tabbed_window;
 }
 
+/* the container of pages must be a `ol` or `ul` element */
+static ws_widget_type_t get_page_type_in_group(pcdom_element_t *element)
+{
+    if (has_tag(element, "OL")) {
+        return WS_WIDGET_TYPE_PANEDPAGE;
+    }
+    else if (has_tag(element, "UL")) {
+        return WS_WIDGET_TYPE_TABBEDPAGE;
+    }
+
+    return WS_WIDGET_TYPE_NONE;
+}
+
+ws_widget_type_t ws_layouter_get_page_type(struct ws_layouter *layouter,
+        const char *group_id)
+{
+    pcdom_document_t *dom_doc = pcdom_interface_document(layouter->dom_doc);
+    pcdom_element_t *element = dom_get_element_by_id(dom_doc, group_id);
+
+    return element ? get_page_type_in_group(element) : WS_WIDGET_TYPE_NONE;
+}
+
 #define HTML_FRAG_PAGE  \
     "<li id='%s-%s' class='%s' name='%s' title='%s' style='%s' level='%s'></li>"
 
@@ -1013,16 +1235,7 @@ void *ws_layouter_add_widget(struct ws_layouter *layouter, void *session,
     void *widget = NULL;
 
     if (element) {
-        ws_widget_type_t widget_type = WS_WIDGET_TYPE_NONE;
-
-        /* the element must be a `ol` or `ul` element */
-        if (has_tag(element, "OL")) {
-            widget_type = WS_WIDGET_TYPE_PANEDPAGE;
-        }
-        else if (has_tag(element, "UL")) {
-            widget_type = WS_WIDGET_TYPE_TABBEDPAGE;
-        }
-
+        ws_widget_type_t widget_type = get_page_type_in_group(element);
         if (widget_type == WS_WIDGET_TYPE_NONE) {
             purc_log_error("Container is not a `OL` or `UL` element (%s)\n",
                     group_id);
@@ -1071,7 +1284,7 @@ void *ws_layouter_add_widget(struct ws_layouter *layouter, void *session,
             }
 
             /* re-layout the exsiting widgets */
-            relayout(layouter, session, article);
+            relayout(layouter, session);
 
             pcdom_element_t *li = find_page_element(dom_doc,
                     group_id, page_name);
@@ -1108,11 +1321,9 @@ int ws_layouter_remove_widget_by_id(struct ws_layouter *layouter,
 
     /* the element must be a `li` element */
     if (element && has_tag(element, "LI")) {
-        pcdom_element_t *article = find_article_ancestor(element);
-
         destroy_widget_for_element(layouter, session, element);
         dom_erase_element(dom_doc, element);
-        relayout(layouter, session, article);
+        relayout(layouter, session);
 
         return PCRDR_SC_OK;
     }
@@ -1135,11 +1346,9 @@ int ws_layouter_remove_widget_by_handle(struct ws_layouter *layouter,
 
         /* the element must be a `LI` element */
         if (has_tag(element, "LI")) {
-            pcdom_element_t *article = find_article_ancestor(element);
-
             destroy_widget_for_element(layouter, session, element);
             dom_erase_element(dom_doc, element);
-            relayout(layouter, session, article);
+            relayout(layouter, session);
 
             return PCRDR_SC_OK;
         }
@@ -1197,8 +1406,7 @@ int ws_layouter_update_widget(struct ws_layouter *layouter, void *session,
                 }
 
                 if (retb) {
-                    pcdom_element_t *section = find_section_ancestor(element);
-                    relayout(layouter, session, section);
+                    relayout(layouter, session);
                     goto done;
                 }
             }
@@ -1230,8 +1438,7 @@ int ws_layouter_update_widget(struct ws_layouter *layouter, void *session,
                 }
 
                 if (retb) {
-                    pcdom_element_t *section = find_section_ancestor(element);
-                    relayout(layouter, session, section);
+                    relayout(layouter, session);
                     goto done;
                 }
             }
@@ -1285,3 +1492,8 @@ ws_layouter_retrieve_widget_by_id(struct ws_layouter *layouter,
     return WS_WIDGET_TYPE_NONE;
 }
 
+void ws_layouter_get_stats(struct ws_layouter *layouter,
+        struct ws_layouter_stats *stats)
+{
+    *stats = layouter->stats;
+}
@@ -82,6 +82,14 @@ struct ws_widget_info {
     struct purc_window_transition transition;
 };
 
+/* The statistics of the geometry updates issued by the layouter */
+struct ws_layouter_stats {
+    unsigned long nr_relayouts;
+    unsigned long nr_box_layouts;           /* full layouts of the boxes */
+    unsigned long nr_geometry_applied;      /* passed to cb_update_widget */
+    unsigned long nr_geometry_suppressed;   /* skipped since not changed */
+};
+
 typedef void (*wsltr_convert_style_fn)(struct ws_widget_info *style,
         purc_variant_t toolkit_style);
 
@@ -111,6 +119,9 @@ struct ws_layouter *ws_layouter_new(struct ws_metrics *metrics,
 /* Destroy a layouter */
 void ws_layouter_delete(struct ws_layouter *layouter, void *sess);
 
+/* Release the default CSS shared by all layouters */
+void ws_layouter_cleanup_cache(void);
+
 /* Add new page groups */
 int ws_layouter_add_widget_groups(struct ws_layouter *layouter,
         const char *html_fragment, size_t sz_html_fragment);
@@ -151,6 +162,10 @@ int ws_layouter_remove_widget_by_handle(struct ws_layouter *layouter,
 int ws_layouter_update_widget(struct ws_layouter *layouter,
         void *session, void *widget, const char *property, purc_variant_t value);
 
+/* Get the type of the page which will be added to the group */
+ws_widget_type_t ws_layouter_get_page_type(struct ws_layouter *layouter,
+        const char *group_id);
+
 /* Retrieve a widget */
 ws_widget_type_t ws_layouter_retrieve_widget(struct ws_layouter *layouter,
         void *widget);
@@ -160,6 +175,18 @@ ws_widget_type_t
 ws_layouter_retrieve_widget_by_id(struct ws_layouter *layouter,
         const char *group_id, const char *page_name);
 
+/* Begin a batch: the relayout triggered by adding, removing, or updating
+   widgets is deferred until the matching ws_layouter_commit(). Batches
+   can be nested. */
+void ws_layouter_begin_batch(struct ws_layouter *layouter);
+
+/* End a batch and relayout the changed widgets once */
+int ws_layouter_commit(struct ws_layouter *layouter, void *session);
+
+/* Get the statistics of the geometry updates */
+void ws_layouter_get_stats(struct ws_layouter *layouter,
+        struct ws_layouter_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
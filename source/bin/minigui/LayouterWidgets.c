@@ -517,6 +517,42 @@ void
 mg_imp_update_widget(void *workspace, void *session, void *widget,
         ws_widget_type_t type, const struct ws_widget_info *style)
 {
+    if (!(style->flags & WSWS_FLAG_GEOMETRY)) {
+        return;
+    }
+
+    HWND hwnd = HWND_INVALID;
+    switch (type) {
+    case WS_WIDGET_TYPE_TABBEDWINDOW:
+        hwnd = browser_tabbed_window_get_hwnd(BROWSER_TABBED_WINDOW(widget));
+        break;
+
+    case WS_WIDGET_TYPE_CONTAINER:
+        hwnd = browser_layout_container_get_hwnd(
+                BROWSER_LAYOUT_CONTAINER(widget));
+        break;
+
+    case WS_WIDGET_TYPE_PANEHOST:
+        hwnd = browser_pane_container_get_hwnd(BROWSER_PANE_CONTAINER(widget));
+        break;
+
+    case WS_WIDGET_TYPE_TABHOST:
+        hwnd = browser_tab_container_get_hwnd(BROWSER_TAB_CONTAINER(widget));
+        break;
+
+    case WS_WIDGET_TYPE_PANEDPAGE:
+        hwnd = BROWSER_PANE(widget)->hwnd;
+        break;
+
+    default:
+        /* a plain window has its own geometry, and the geometry of
+           a tabbed page is managed by its tab host */
+        break;
+    }
+
+    if (hwnd != HWND_INVALID) {
+        MoveWindow(hwnd, style->x, style->y, style->w, style->h, TRUE);
+    }
 }
 
 /* FIXME */
@@ -30,6 +30,8 @@
 #include "BuildRevision.h"
 #include "PurcmcCallbacks.h"
 #include "schema/HVMLURISchema.h"
+#include "schema/AssetCache.h"
+#include "schema/MimeTypes.h"
 #include "schema/HbdrunURISchema.h"
 #include "LayouterWidgets.h"
 
@@ -58,6 +60,43 @@ int pcmc_mg_prepare(purcmc_server *srv)
     return 0;
 }
 
+static gboolean commit_layout_batch(gpointer user_data)
+{
+    purcmc_workspace *workspace = user_data;
+
+    workspace->layout_batch = 0;
+    ws_layouter_commit(workspace->layouter, workspace->batch_session);
+    workspace->batch_session = NULL;
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * A burst of requests (e.g. the `createWidget` requests for the pages of
+ * a tabbed window) is handled in one iteration of the main loop, so the
+ * widgets are laid out once when the main loop becomes idle; the priority
+ * makes the batch committed before the next redrawing.
+ */
+static void begin_layout_batch(purcmc_session *sess,
+        purcmc_workspace *workspace)
+{
+    if (workspace->layout_batch == 0) {
+        ws_layouter_begin_batch(workspace->layouter);
+        workspace->batch_session = sess;
+        workspace->layout_batch = g_idle_add_full(G_PRIORITY_HIGH_IDLE,
+                commit_layout_batch, workspace, NULL);
+    }
+}
+
+/* Call this before deleting the layouter */
+static void cancel_layout_batch(purcmc_workspace *workspace)
+{
+    if (workspace->layout_batch) {
+        g_source_remove(workspace->layout_batch);
+        workspace->layout_batch = 0;
+        workspace->batch_session = NULL;
+    }
+}
+
 void pcmc_mg_cleanup(purcmc_server *srv)
 {
     const char *name;
@@ -68,12 +107,16 @@ void pcmc_mg_cleanup(purcmc_server *srv)
 
         pcutils_kvlist_delete(workspace->page_owners);
         if (workspace->layouter) {
+            cancel_layout_batch(workspace);
             ws_layouter_delete(workspace->layouter, NULL);
         }
         free(workspace);
     }
 
     kvlist_free(&kv_app_workspace);
+    ws_layouter_cleanup_cache();
+    asset_cache_cleanup();
+    mime_types_cleanup();
 }
 
 static purcmc_workspace *create_or_get_workspace(purcmc_endpoint* endpoint)
@@ -547,6 +590,7 @@ int mg_remove_session(purcmc_session *sess)
 
     LOG_DEBUG("deleting layouter ...\n");
     if (sess->workspace->layouter) {
+        cancel_layout_batch(sess->workspace);
         ws_layouter_delete(sess->workspace->layouter, sess);
         sess->workspace->layouter = NULL;
     }
@@ -1730,6 +1774,8 @@ mg_create_widget(purcmc_session *sess, purcmc_workspace *workspace,
         *retv = PCRDR_SC_PRECONDITION_FAILED;
     }
     else {
+        begin_layout_batch(sess, workspace);
+
         WebKitWebViewParam webview_param = {0};
         init_web_view_param(sess, &webview_param);
 
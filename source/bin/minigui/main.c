@@ -147,9 +147,17 @@ static const GOptionEntry commandLineOptions[] =
 #if HAVE(LIBSSL)
     { "pcmc-sslcert", 0, 0, G_OPTION_ARG_STRING, &pcmc_srvcfg.sslcert, "The path to SSL certificate", "FILE" },
     { "pcmc-sslkey", 0, 0, G_OPTION_ARG_STRING, &pcmc_srvcfg.sslkey, "The path to SSL private key", "FILE" },
+    { "pcmc-tlsworkers", 0, 0, G_OPTION_ARG_INT, &pcmc_srvcfg.tls_workers, "The number of threads doing TLS handshakes (-1 for the main thread)", "NUMBER" },
+    { "pcmc-notlstickets", 0, 0, G_OPTION_ARG_NONE, &pcmc_srvcfg.notlstickets, "Without support for TLS session tickets", NULL },
 #endif
     { "pcmc-maxfrmsize", 0, 0, G_OPTION_ARG_INT, &pcmc_srvcfg.max_frm_size, "The maximum size of a socket frame", "BYTES" },
     { "pcmc-backlog", 0, 0, G_OPTION_ARG_INT, &pcmc_srvcfg.backlog, "The maximum length to which the queue of pending connections.", "NUMBER" },
+#if HAVE(ZLIB)
+    { "pcmc-nodeflate", 0, 0, G_OPTION_ARG_NONE, &pcmc_srvcfg.nodeflate, "Without support for the permessage-deflate extension of WebSocket", NULL },
+    { "pcmc-deflate-wbits", 0, 0, G_OPTION_ARG_INT, &pcmc_srvcfg.deflate_wbits, "The maximal window bits (9~15) used to compress WebSocket messages", "BITS" },
+    { "pcmc-deflate-minsize", 0, 0, G_OPTION_ARG_INT, &pcmc_srvcfg.deflate_min_size, "The minimal size of a WebSocket message to compress", "BYTES" },
+    { "pcmc-deflate-noctx", 0, 0, G_OPTION_ARG_NONE, &pcmc_srvcfg.deflate_no_ctx_takeover, "Do not take over the compression context between WebSocket messages", NULL },
+#endif
     { "name", 'n', 0, G_OPTION_ARG_STRING, &pcmc_srvcfg.name, "The name of the current renderer", "xGUI Pro" },
 
 #if WEBKIT_CHECK_VERSION(2, 30, 0)
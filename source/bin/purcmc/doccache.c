@@ -0,0 +1,167 @@
+/*
+** doccache.c -- The content-addressed cache of loaded documents.
+**
+** Copyright (C) 2023 FMSoft (http://www.fmsoft.cn)
+**
+** This file is part of xGUI Pro, an advanced HVML renderer.
+**
+** xGUI Pro is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** xGUI Pro is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see http://www.gnu.org/licenses/.
+*/
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "doccache.h"
+#include "utils/avl.h"
+#include "utils/avl-cmp.h"
+#include "utils/list.h"
+#include "utils/utils.h"
+
+struct doc_entry {
+    /* the AVL node in the tree sorted by the hash */
+    struct avl_node avl;
+
+    /* the node in the list in the most recently used order */
+    struct list_head lru;
+
+    char hash[DOC_CACHE_HASH_LEN + 1];
+    size_t len;
+
+    /* the null-terminated document */
+    char text[0];
+};
+
+struct doc_cache {
+    struct avl_tree entries;
+    struct list_head lru;
+
+    size_t size, max_size;
+    unsigned nr_entries, max_entries;
+};
+
+struct doc_cache *doc_cache_new(size_t max_size, unsigned max_entries)
+{
+    struct doc_cache *cache = calloc(1, sizeof(*cache));
+    if (cache) {
+        avl_init(&cache->entries, avl_strcmp, false, NULL);
+        list_head_init(&cache->lru);
+        cache->max_size = max_size;
+        cache->max_entries = max_entries;
+    }
+
+    return cache;
+}
+
+static void remove_entry(struct doc_cache *cache, struct doc_entry *entry)
+{
+    avl_delete(&cache->entries, &entry->avl);
+    list_del(&entry->lru);
+    cache->size -= entry->len;
+    cache->nr_entries--;
+    free(entry);
+}
+
+void doc_cache_delete(struct doc_cache *cache)
+{
+    struct doc_entry *entry, *tmp;
+
+    list_for_each_entry_safe(entry, tmp, &cache->lru, lru) {
+        remove_entry(cache, entry);
+    }
+
+    free(cache);
+}
+
+bool doc_cache_parse_property(const char *property,
+        char hash[DOC_CACHE_HASH_LEN + 1])
+{
+    const size_t len_prefix = sizeof(DOC_CACHE_HASH_PREFIX) - 1;
+
+    if (property == NULL ||
+            strncmp(property, DOC_CACHE_HASH_PREFIX, len_prefix))
+        return false;
+
+    property += len_prefix;
+    for (int i = 0; i < DOC_CACHE_HASH_LEN; i++) {
+        if (!isxdigit((unsigned char)property[i]))
+            return false;
+        hash[i] = tolower((unsigned char)property[i]);
+    }
+
+    if (property[DOC_CACHE_HASH_LEN] != '\0')
+        return false;
+
+    hash[DOC_CACHE_HASH_LEN] = '\0';
+    return true;
+}
+
+const char *doc_cache_get(struct doc_cache *cache, const char *hash,
+        size_t *len)
+{
+    struct doc_entry *entry;
+
+    entry = avl_find_element(&cache->entries, hash, entry, avl);
+    if (entry == NULL)
+        return NULL;
+
+    list_move(&entry->lru, &cache->lru);
+    if (len)
+        *len = entry->len;
+    return entry->text;
+}
+
+bool doc_cache_put(struct doc_cache *cache, const char *hash,
+        const char *text, size_t len)
+{
+    uint8_t digest[PCUTILS_SHA256_DIGEST_SIZE];
+    char hex[DOC_CACHE_HASH_LEN + 1];
+
+    pcutils_sha256_calc_digest(text, len, digest);
+    pcutils_bin2hex(digest, sizeof(digest), hex, false);
+    hex[DOC_CACHE_HASH_LEN] = '\0';
+    if (strcmp(hex, hash)) {
+        LOG_WARN("Mismatched content hash: %s claimed, %s computed\n",
+                hash, hex);
+        return false;
+    }
+
+    /* too large to be cached; the later requests get NotFound */
+    if (len > cache->max_size || doc_cache_get(cache, hash, NULL))
+        return true;
+
+    struct doc_entry *entry = malloc(sizeof(*entry) + len + 1);
+    if (entry == NULL)
+        return false;
+
+    strcpy(entry->hash, hash);
+    entry->len = len;
+    memcpy(entry->text, text, len);
+    entry->text[len] = '\0';
+
+    while (cache->nr_entries > 0 &&
+            (cache->nr_entries >= cache->max_entries ||
+             cache->size + len > cache->max_size)) {
+        remove_entry(cache, list_last_entry(&cache->lru,
+                    struct doc_entry, lru));
+    }
+
+    entry->avl.key = entry->hash;
+    avl_insert(&cache->entries, &entry->avl);
+    list_add(&entry->lru, &cache->lru);
+    cache->size += len;
+    cache->nr_entries++;
+    return true;
+}
@@ -0,0 +1,68 @@
+/*
+** doccache.h -- The content-addressed cache of loaded documents.
+**
+** Copyright (C) 2023 FMSoft (http://www.fmsoft.cn)
+**
+** This file is part of xGUI Pro, an advanced HVML renderer.
+**
+** xGUI Pro is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** xGUI Pro is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef XGUIPRO_PURCMC_DOCCACHE_H
+#define XGUIPRO_PURCMC_DOCCACHE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <purc/purc-utils.h>
+
+/* The property of a `load` request referring to a document by its hash:
+   `contentHash:<the SHA-256 digest of the document in hex>` */
+#define DOC_CACHE_HASH_PREFIX       "contentHash:"
+
+#define DOC_CACHE_HASH_LEN          (PCUTILS_SHA256_DIGEST_SIZE * 2)
+
+/* the limits of the cache */
+#define DOC_CACHE_MAX_SIZE          (16 * 1024 * 1024)
+#define DOC_CACHE_MAX_ENTRIES       64
+
+struct doc_cache;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct doc_cache *doc_cache_new(size_t max_size, unsigned max_entries);
+void doc_cache_delete(struct doc_cache *cache);
+
+/* Gets the hash in the property of a `load` request. Returns false if the
+   property does not refer to a document; the hash is in lowercase. */
+bool doc_cache_parse_property(const char *property,
+        char hash[DOC_CACHE_HASH_LEN + 1]);
+
+/* Returns the null-terminated document of the hash and marks it as the most
+   recently used one, or NULL if there is no such document. */
+const char *doc_cache_get(struct doc_cache *cache, const char *hash,
+        size_t *len);
+
+/* Keeps a copy of the document unless it is larger than the cache;
+   evicts the least recently used documents if the limits are exceeded.
+   Returns false if the document does not match the hash. */
+bool doc_cache_put(struct doc_cache *cache, const char *hash,
+        const char *text, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !XGUIPRO_PURCMC_DOCCACHE_H */
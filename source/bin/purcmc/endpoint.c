@@ -28,6 +28,7 @@
 #include <unistd.h>
 
 #include "endpoint.h"
+#include "doccache.h"
 #include "unixsocket.h"
 #include "websocket.h"
 #include "utils/utils.h"
@@ -1908,16 +1909,41 @@ static int on_load(purcmc_server* srv, purcmc_endpoint* endpoint,
     purcmc_page *page = NULL;
     purcmc_udom *dom = NULL;
     char suppressed[LEN_BUFF_LONGLONGINT] = { };
+    char hash[DOC_CACHE_HASH_LEN + 1];
+    bool with_hash;
 
-    if (((msg->dataType != PCRDR_MSG_DATA_TYPE_HTML) &&
-                (msg->dataType != PCRDR_MSG_DATA_TYPE_PLAIN)) ||
-            msg->data == PURC_VARIANT_INVALID) {
+    with_hash = doc_cache_parse_property(
+            purc_variant_get_string_const(msg->property), hash);
+
+    doc_text = NULL;
+    doc_len = 0;
+    if (((msg->dataType == PCRDR_MSG_DATA_TYPE_HTML) ||
+                (msg->dataType == PCRDR_MSG_DATA_TYPE_PLAIN)) &&
+            msg->data != PURC_VARIANT_INVALID) {
+        doc_text = purc_variant_get_string_const_ex(msg->data, &doc_len);
+    }
+    else if (!with_hash || msg->dataType != PCRDR_MSG_DATA_TYPE_VOID) {
         retv = PCRDR_SC_BAD_REQUEST;
         goto failed;
     }
 
-    doc_text = purc_variant_get_string_const_ex(msg->data, &doc_len);
-    if (doc_text == NULL || doc_len == 0) {
+    if (doc_text && doc_len > 0) {
+        /* keep the document for the later requests referring to it */
+        if (with_hash && !doc_cache_put(srv->doc_cache, hash,
+                    doc_text, doc_len)) {
+            retv = PCRDR_SC_BAD_REQUEST;
+            goto failed;
+        }
+    }
+    else if (with_hash) {
+        /* the client resends the document if it was evicted */
+        doc_text = doc_cache_get(srv->doc_cache, hash, &doc_len);
+        if (doc_text == NULL) {
+            retv = PCRDR_SC_NOT_FOUND;
+            goto failed;
+        }
+    }
+    else {
         retv = PCRDR_SC_BAD_REQUEST;
         goto failed;
     }
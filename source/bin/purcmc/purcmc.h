@@ -66,6 +66,16 @@ typedef struct purcmc_server_config {
     char *name;
     int max_frm_size;
     int backlog;
+
+    /* options for the permessage-deflate extension of WebSocket */
+    int nodeflate;
+    int deflate_wbits;
+    int deflate_min_size;
+    int deflate_no_ctx_takeover;
+
+    /* options for TLS */
+    int tls_workers;
+    int notlstickets;
 } purcmc_server_config;
 
 typedef struct purcmc_server_callbacks {
@@ -36,6 +36,7 @@
 #include "websocket.h"
 #include "unixsocket.h"
 #include "endpoint.h"
+#include "doccache.h"
 
 #include "sd/sd.h"
 
@@ -55,6 +56,9 @@ static purcmc_server_config* the_srvcfg;
 #define MAX_LOCALE_LENGTH   128
 #define MAX_DPI_LENGTH      64
 
+/* the initial size of the pollfd array and the fd table for poll */
+#define MIN_POLL_SLOTS      16
+
 /* callbacks for socket servers */
 // Allocate a purcmc_endpoint structure for a new client and send `auth` packet.
 static int
@@ -112,34 +116,119 @@ on_packet(void* sock_srv, SockClient* client,
     return PCRDR_SC_OK;
 }
 
-#if !HAVE(SYS_EPOLL_H) && HAVE(SYS_SELECT_H)
+#if !HAVE(SYS_EPOLL_H) && HAVE(POLL_H)
 static int
 listen_new_client(int fd, void *ptr, bool rw)
 {
-    if (sorted_array_add(the_server.fd2clients, (uint64_t)fd, ptr)) {
+    struct poll_slot *slot;
+
+    if (fd < 0)
         return -1;
+
+    if ((unsigned int)fd >= the_server.sz_fd2slots) {
+        unsigned int sz = the_server.sz_fd2slots ?
+            the_server.sz_fd2slots : MIN_POLL_SLOTS;
+
+        while (sz <= (unsigned int)fd)
+            sz <<= 1;
+
+        slot = realloc(the_server.fd2slots, sizeof(*slot) * sz);
+        if (slot == NULL)
+            return -1;
+
+        memset(slot + the_server.sz_fd2slots, 0,
+                sizeof(*slot) * (sz - the_server.sz_fd2slots));
+        the_server.fd2slots = slot;
+        the_server.sz_fd2slots = sz;
+    }
+
+    slot = the_server.fd2slots + fd;
+    if (slot->ptr) {
+        return -1;
+    }
+
+    if (the_server.nr_pollfds == the_server.sz_pollfds) {
+        unsigned int sz = the_server.sz_pollfds ?
+            the_server.sz_pollfds * 2 : MIN_POLL_SLOTS;
+        struct pollfd *pfds;
+
+        pfds = realloc(the_server.pollfds, sizeof(*pfds) * sz);
+        if (pfds == NULL)
+            return -1;
+
+        the_server.pollfds = pfds;
+        the_server.sz_pollfds = sz;
     }
 
-    FD_SET(fd, &the_server.rfdset);
+    slot->ptr = ptr;
+    slot->idx = the_server.nr_pollfds++;
+    the_server.pollfds[slot->idx].fd = fd;
+    the_server.pollfds[slot->idx].events = rw ? (POLLIN | POLLOUT) : POLLIN;
+    the_server.pollfds[slot->idx].revents = 0;
+    return 0;
+}
+
+static void *
+find_listening_client(int fd)
+{
+    if (fd >= 0 && (unsigned int)fd < the_server.sz_fd2slots)
+        return the_server.fd2slots[fd].ptr;
+
+    return NULL;
+}
+
+static int
+listen_for_writing(int fd, bool rw)
+{
+    struct pollfd *pfd;
+
+    if (find_listening_client(fd) == NULL)
+        return -1;
+
+    pfd = the_server.pollfds + the_server.fd2slots[fd].idx;
     if (rw)
-        FD_SET(fd, &the_server.wfdset);
+        pfd->events |= POLLOUT;
+    else
+        pfd->events &= ~POLLOUT;
+    return 0;
+}
 
-    if (the_server.maxfd < fd)
-        the_server.maxfd = fd;
+static int
+listen_for_reading(int fd, bool rd)
+{
+    struct pollfd *pfd;
 
+    if (find_listening_client(fd) == NULL)
+        return -1;
+
+    pfd = the_server.pollfds + the_server.fd2slots[fd].idx;
+    if (rd)
+        pfd->events |= POLLIN;
+    else
+        pfd->events &= ~POLLIN;
     return 0;
 }
 
+/* Remove the fd by moving the last pollfd to its place. */
 static int
 remove_listening_client(int fd)
 {
-    if (sorted_array_remove(the_server.fd2clients, (uint64_t)fd)) {
-        FD_CLR(fd, &the_server.rfdset);
-        FD_CLR(fd, &the_server.wfdset);
-        return 0;
+    struct poll_slot *slot;
+    unsigned int last;
+
+    if (find_listening_client(fd) == NULL)
+        return -1;
+
+    slot = the_server.fd2slots + fd;
+    last = --the_server.nr_pollfds;
+    if (slot->idx != last) {
+        the_server.pollfds[slot->idx] = the_server.pollfds[last];
+        the_server.fd2slots[the_server.pollfds[slot->idx].fd].idx = slot->idx;
     }
 
-    return -1;
+    slot->ptr = NULL;
+    slot->idx = 0;
+    return 0;
 }
 #endif
 
@@ -147,21 +236,15 @@ static int
 on_pending(void* sock_srv, SockClient* client)
 {
 #if HAVE(SYS_EPOLL_H)
-    struct epoll_event ev;
-
+    /* The client was registered with EPOLLOUT in the edge-triggered mode,
+       and we will get the event once the socket becomes writable again. */
     (void)sock_srv;
-    ev.events = EPOLLIN | EPOLLOUT;
-    ev.data.ptr = client;
-    if (epoll_ctl(the_server.epollfd, EPOLL_CTL_MOD, client->fd, &ev) == -1) {
-        purc_log_error("Failed epoll_ctl to the client fd (%d): %s\n",
-                client->fd, strerror(errno));
-        assert(0);
-    }
-#elif HAVE(SYS_SELECT_H)
+    (void)client;
+#elif HAVE(POLL_H)
     (void)sock_srv;
 
-    if (listen_new_client(client->fd, client, TRUE)) {
-        purc_log_error("Failed to insert to the client AVL tree: %d\n", client->fd);
+    if (listen_for_writing(client->fd, true)) {
+        purc_log_error("Failed to find the client in the fd table: %d\n", client->fd);
         assert(0);
     }
 #endif
@@ -169,6 +252,22 @@ on_pending(void* sock_srv, SockClient* client)
     return 0;
 }
 
+#if !HAVE(SYS_EPOLL_H) && HAVE(POLL_H) && HAVE(LIBSSL)
+/* The level-triggered poll() would report the bytes of the handshake on
+   every round while a worker is doing it, so stop watching the reads. */
+static void
+on_tls_offload(void* sock_srv, SockClient* client, int offloaded)
+{
+    (void)sock_srv;
+
+    if (listen_for_reading(client->fd, !offloaded)) {
+        purc_log_error("Failed to find the client in the fd table: %d\n",
+                client->fd);
+        assert(0);
+    }
+}
+#endif
+
 static int
 on_close(void* sock_srv, SockClient* client)
 {
@@ -179,11 +278,11 @@ on_close(void* sock_srv, SockClient* client)
         purc_log_warn("Failed to call epoll_ctl to delete the client fd (%d): %s\n",
                 client->fd, strerror(errno));
     }
-#elif HAVE(SYS_SELECT_H)
+#elif HAVE(POLL_H)
     (void)sock_srv;
 
     if (remove_listening_client(client->fd)) {
-        purc_log_warn("Failed to delete the client fd (%d) from the listening fdset\n",
+        purc_log_warn("Failed to delete the client fd (%d) from the pollfd array\n",
                 client->fd);
     }
 #endif
@@ -324,6 +423,10 @@ setup_signal_pipe(void)
 /* max events for epoll */
 #define MAX_EVENTS          10
 
+/* max connections accepted and reads done for a client in one round */
+#define ACCEPT_BUDGET       32
+#define READ_BUDGET         64
+
 static int
 prepare_server(void)
 {
@@ -374,6 +477,9 @@ prepare_server(void)
         the_server.ws_srv->on_pending = on_pending;
         the_server.ws_srv->on_close = on_close;
         the_server.ws_srv->on_error = on_error;
+#if !HAVE(SYS_EPOLL_H) && HAVE(POLL_H) && HAVE(LIBSSL)
+        the_server.ws_srv->on_tls_offload = on_tls_offload;
+#endif
 
         purc_log_info("Listening on Web Socket (%s, %s) %s SSL...\n",
                 the_srvcfg->addr, the_srvcfg->port,
@@ -416,7 +522,7 @@ prepare_server(void)
 #endif /* PCA_ENABLE_DNSSD */
 
     }
-#elif HAVE(SYS_SELECT_H)
+#elif HAVE(POLL_H)
     listen_new_client(the_server.us_listener, PTR_FOR_US_LISTENER, FALSE);
     if (the_server.ws_listener >= 0) {
         listen_new_client(the_server.ws_listener, PTR_FOR_WS_LISTENER, FALSE);
@@ -435,14 +541,135 @@ error:
     return -1;
 }
 
+/* Check the endpoints for timeouts once a second when idle. */
+static void
+check_timers(void)
+{
+    the_server.t_elapsed = purc_get_monotoic_time() - the_server.t_start;
+    if (the_server.t_elapsed != the_server.t_elapsed_last) {
+        if (the_server.t_elapsed % 10 == 0) {
+            check_no_responding_endpoints(&the_server);
+        }
+        else if (the_server.t_elapsed % 5 == 0) {
+            check_dangling_endpoints(&the_server);
+        }
+        /* startSession timeout */
+        check_timeout_dangling_endpoints(&the_server);
+
+        the_server.t_elapsed_last = the_server.t_elapsed;
+    }
+}
+
 #if HAVE(SYS_EPOLL_H)
+/* Register a connected client once in the edge-triggered mode, so that
+   we do not need to call epoll_ctl() when toggling the writing state. */
+static int
+watch_client(SockClient *client, int op)
+{
+    struct epoll_event ev;
+
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = client;
+    if (epoll_ctl(the_server.epollfd, op, client->fd, &ev) == -1) {
+        purc_log_error("Failed epoll_ctl for connected %s socket (%d): %s\n",
+                (client->ct == CT_UNIX_SOCKET) ? "unix" : "web",
+                client->fd, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Accept the pending connections on the listener up to ACCEPT_BUDGET.
+   Returns 1 if there may be more connections left; the epoll listener is
+   level-triggered, so the rest will be reported again. */
+static int
+accept_clients(void *listener)
+{
+    int i, retv = 0;
+    SockClient *client;
+
+    for (i = 0; i < ACCEPT_BUDGET; i++) {
+        if (listener == PTR_FOR_US_LISTENER) {
+            client = (SockClient *)us_handle_accept(the_server.us_srv, &retv);
+        }
+        else {
+            client = (SockClient *)ws_handle_accept(the_server.ws_srv,
+                    the_server.ws_listener, &retv);
+        }
+
+        if (client == NULL) {
+            if (retv)
+                break;  /* the backlog is drained */
+
+            purc_log_info("Refused a client\n");
+        }
+        else if (watch_client(client, EPOLL_CTL_ADD)) {
+            return -1;
+        }
+    }
+
+    return (i == ACCEPT_BUDGET) ? 1 : 0;
+}
+
+/* Read from an edge-triggered client until there is nothing left.
+   Returns -1 if the client has been closed, 1 if there is data left
+   after READ_BUDGET reads, and 0 otherwise. */
+static int
+handle_client_reads(SockClient *client)
+{
+    int i;
+
+    if (client->entity) {
+        purcmc_endpoint *endpoint = container_of(client->entity,
+                purcmc_endpoint, entity);
+        update_endpoint_living_time(&the_server, endpoint);
+    }
+
+    /* read until a read finds nothing left, instead of peeking */
+    for (i = 0; i < READ_BUDGET; i++) {
+        if (client->ct == CT_UNIX_SOCKET) {
+            /* the client has been freed if a non-zero value returned */
+            if (us_handle_reads(the_server.us_srv, (USClient *)client))
+                return -1;
+            if (((USClient *)client)->status & US_DRAINED)
+                return 0;
+        }
+        else {
+            /* the client has been cleaned up if a negative value returned */
+            int ret = ws_handle_reads(the_server.ws_srv, (WSClient *)client);
+            if (ret < 0)
+                return -1;
+            /* the client is closing after the pending data is sent */
+            if (((WSClient *)client)->status & WS_CLOSE)
+                return 0;
+#if HAVE(LIBSSL)
+            /* the TLS handshake or shutdown is still in progress */
+            if (ret > 0 && (((WSClient *)client)->sslstatus &
+                        (WS_TLS_OFFLOADED | WS_TLS_ACCEPTING |
+                         WS_TLS_SHUTTING)))
+                return 0;
+#endif
+            if (((WSClient *)client)->drained)
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
 bool purcmc_rdrsrv_check(purcmc_server *srv)
 {
     int nfds, n;
-    struct epoll_event ev, events[MAX_EVENTS];
+    struct epoll_event events[MAX_EVENTS];
 
     (void)srv;
 
+#if HAVE(LIBSSL)
+    if (the_server.ws_srv)
+        ws_handle_tls_handshakes(the_server.ws_srv);
+#endif
+
 again:
     nfds = epoll_wait(the_server.epollfd, events, MAX_EVENTS, 0);
     if (nfds < 0) {
@@ -454,54 +681,14 @@ again:
         goto error;
     }
     else if (nfds == 0) {
-        the_server.t_elapsed = purc_get_monotoic_time() - the_server.t_start;
-        if (the_server.t_elapsed != the_server.t_elapsed_last) {
-            if (the_server.t_elapsed % 10 == 0) {
-                check_no_responding_endpoints(&the_server);
-            }
-            else if (the_server.t_elapsed % 5 == 0) {
-                check_dangling_endpoints(&the_server);
-            }
-            /* startSession timeout */
-            check_timeout_dangling_endpoints(&the_server);
-
-            the_server.t_elapsed_last = the_server.t_elapsed;
-        }
+        check_timers();
     }
 
     for (n = 0; n < nfds; ++n) {
-        if (events[n].data.ptr == PTR_FOR_US_LISTENER) {
-            USClient * client = us_handle_accept(the_server.us_srv);
-            if (client == NULL) {
-                purc_log_info("Refused a client\n");
-            }
-            else {
-                ev.events = EPOLLIN; /* do not use EPOLLET */
-                ev.data.ptr = client;
-                if (epoll_ctl(the_server.epollfd,
-                            EPOLL_CTL_ADD, client->fd, &ev) == -1) {
-                    purc_log_error("Failed epoll_ctl for connected unix socket (%d): %s\n",
-                            client->fd, strerror(errno));
-                    goto error;
-                }
-            }
-        }
-        else if (events[n].data.ptr == PTR_FOR_WS_LISTENER) {
-            WSClient * client = ws_handle_accept(the_server.ws_srv,
-                    the_server.ws_listener);
-            if (client == NULL) {
-                purc_log_info("Refused a client\n");
-            }
-            else {
-                ev.events = EPOLLIN; /* do not use EPOLLET */
-                ev.data.ptr = client;
-                if (epoll_ctl(the_server.epollfd,
-                            EPOLL_CTL_ADD, client->fd, &ev) == -1) {
-                    purc_log_error("Failed epoll_ctl for connected web socket (%d): %s\n",
-                            client->fd, strerror(errno));
-                    goto error;
-                }
-            }
+        if (events[n].data.ptr == PTR_FOR_US_LISTENER ||
+                events[n].data.ptr == PTR_FOR_WS_LISTENER) {
+            if (accept_clients(events[n].data.ptr) < 0)
+                goto error;
         }
 #if PCA_ENABLE_DNSSD
         else if (events[n].data.ptr == PTR_FOR_DNSSD_LISTENER) {
@@ -509,68 +696,36 @@ again:
         }
 #endif /* PCA_ENABLE_DNSSD */
         else {
-            USClient *usc = (USClient *)events[n].data.ptr;
-            if (usc->ct == CT_UNIX_SOCKET) {
+            SockClient *client = (SockClient *)events[n].data.ptr;
 
-                if (events[n].events & EPOLLIN) {
-
-                    if (usc->entity) {
-                        purcmc_endpoint *endpoint = container_of(usc->entity,
-                                purcmc_endpoint, entity);
-                        update_endpoint_living_time(&the_server, endpoint);
-                    }
-
-                    us_handle_reads(the_server.us_srv, usc);
-                }
+            if (client->ct != CT_UNIX_SOCKET && client->ct != CT_INET_SOCKET) {
+                purc_log_error("Bad socket type (%d): %s\n",
+                        client->ct, strerror(errno));
+                goto error;
+            }
 
-                if (events[n].events & EPOLLOUT) {
-                    us_handle_writes(the_server.us_srv, usc);
-
-                    if (!(usc->status & US_SENDING) && !(usc->status & US_CLOSE)) {
-                        ev.events = EPOLLIN;
-                        ev.data.ptr = usc;
-                        if (epoll_ctl(the_server.epollfd,
-                                    EPOLL_CTL_MOD, usc->fd, &ev) == -1) {
-                            purc_log_error("Failed epoll_ctl for unix socket (%d): %s\n",
-                                    usc->fd, strerror(errno));
-                            goto error;
-                        }
-                    }
+            if (events[n].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                int ret = handle_client_reads(client);
+                if (ret < 0)
+                    continue;
+                else if (ret > 0) {
+                    /* re-arm the client to get a new event for the data left */
+                    watch_client(client, EPOLL_CTL_MOD);
                 }
             }
-            else if (usc->ct == CT_INET_SOCKET) {
-                WSClient *wsc = (WSClient *)events[n].data.ptr;
 
-                if (events[n].events & EPOLLIN) {
-                    if (wsc->entity) {
-                        purcmc_endpoint *endpoint = container_of(usc->entity,
-                                purcmc_endpoint, entity);
-                        update_endpoint_living_time(&the_server, endpoint);
-                    }
-
-                    ws_handle_reads(the_server.ws_srv, wsc);
+            if (events[n].events & EPOLLOUT) {
+                if (client->ct == CT_UNIX_SOCKET) {
+                    USClient *usc = (USClient *)client;
+                    if (usc->status & US_SENDING)
+                        us_handle_writes(the_server.us_srv, usc);
                 }
-
-                if (events[n].events & EPOLLOUT) {
-                    ws_handle_writes(the_server.ws_srv, wsc);
-
-                    if (!(wsc->status & WS_SENDING) && !(wsc->status & WS_CLOSE)) {
-                        ev.events = EPOLLIN;
-                        ev.data.ptr = wsc;
-                        if (epoll_ctl(the_server.epollfd,
-                                    EPOLL_CTL_MOD, wsc->fd, &ev) == -1) {
-                            purc_log_error("Failed epoll_ctl for web socket (%d): %s\n",
-                                    usc->fd, strerror(errno));
-                            goto error;
-                        }
-                    }
+                else {
+                    WSClient *wsc = (WSClient *)client;
+                    if (wsc->status & WS_SENDING)
+                        ws_handle_writes(the_server.ws_srv, wsc);
                 }
             }
-            else {
-                purc_log_error("Bad socket type (%d): %s\n",
-                        usc->ct, strerror(errno));
-                goto error;
-            }
         }
     }
 
@@ -580,146 +735,147 @@ error:
     return false;
 }
 
-#elif HAVE(SYS_SELECT_H)
+#elif HAVE(POLL_H)
+
+static int
+accept_clients(void *listener)
+{
+    int i, retv = 0;
+    SockClient *client;
+
+    for (i = 0; i < ACCEPT_BUDGET; i++) {
+        if (listener == PTR_FOR_US_LISTENER) {
+            client = (SockClient *)us_handle_accept(the_server.us_srv, &retv);
+        }
+        else {
+            client = (SockClient *)ws_handle_accept(the_server.ws_srv,
+                    the_server.ws_listener, &retv);
+        }
+
+        if (client == NULL) {
+            if (retv)
+                break;  /* the backlog is drained */
+
+            purc_log_info("Refused a client\n");
+        }
+        else if (listen_new_client(client->fd, client, FALSE)) {
+            purc_log_error("Failed to poll connected %s socket (%d)\n",
+                    (client->ct == CT_UNIX_SOCKET) ? "unix" : "web",
+                    client->fd);
+            return -1;
+        }
+    }
+
+    return 0;
+}
 
 bool purcmc_rdrsrv_check(purcmc_server *srv)
 {
     int retval;
-    fd_set rset, wset;
-    fd_set* rsetptr = NULL;
-    fd_set* wsetptr = NULL;
-    fd_set* esetptr = NULL;
-    struct timeval sel_timeout = { 0, 0 };
+    unsigned int i;
 
-    /* a fdset got modified each time around */
-    FD_COPY(&the_server.rfdset, &rset);
-    rsetptr = &rset;
+    (void)srv;
 
-    FD_COPY(&the_server.wfdset, &wset);
-    wsetptr = &wset;
+#if HAVE(LIBSSL)
+    if (the_server.ws_srv)
+        ws_handle_tls_handshakes(the_server.ws_srv);
+#endif
 
 again:
-    if ((retval = select(the_server.maxfd + 1,
-            rsetptr, wsetptr, esetptr, &sel_timeout)) < 0) {
-        /* no event. */
+    retval = poll(the_server.pollfds, the_server.nr_pollfds, 0);
+    if (retval < 0) {
         if (errno == EINTR) {
             goto again;
         }
 
-        purc_log_error("unexpected error of select(): %m\n");
+        purc_log_error("unexpected error of poll(): %m\n");
         goto error;
     }
     else if (retval == 0) {
-        the_server.t_elapsed = purc_get_monotoic_time() - the_server.t_start;
-        if (the_server.t_elapsed != the_server.t_elapsed_last) {
-            if (the_server.t_elapsed % 10 == 0) {
-                check_no_responding_endpoints(&the_server);
-            }
-            else if (the_server.t_elapsed % 5 == 0) {
-                check_dangling_endpoints(&the_server);
-            }
-            /* startSession timeout */
-            check_timeout_dangling_endpoints(&the_server);
-
-            the_server.t_elapsed_last = the_server.t_elapsed;
+        check_timers();
+        return true;
+    }
+
+    /* Walk backwards: a removed pollfd is replaced by the last one, which
+       has been handled; the revents is reset before handling the fd, so
+       a pollfd moved ahead of us will not be handled twice. */
+    for (i = the_server.nr_pollfds; i > 0; i--) {
+        struct pollfd *pfd;
+        short revents;
+        void *cli_node;
+        int fd;
+
+        if (i > the_server.nr_pollfds)
+            continue;
+
+        pfd = the_server.pollfds + i - 1;
+        if (pfd->revents == 0)
+            continue;
+
+        fd = pfd->fd;
+        revents = pfd->revents;
+        pfd->revents = 0;
+        cli_node = find_listening_client(fd);
+
+        if (cli_node == PTR_FOR_US_LISTENER ||
+                cli_node == PTR_FOR_WS_LISTENER) {
+            if (accept_clients(cli_node))
+                goto error;
+            continue;
         }
-    }
-    else {
-        size_t i, nr_fds = sorted_array_count(the_server.fd2clients);
-        int *fds = alloca(sizeof(int) * nr_fds);
+#if PCA_ENABLE_DNSSD
+        else if (cli_node == PTR_FOR_DNSSD_LISTENER) {
+            purc_dnssd_process_result(the_server.dnssd);
+            continue;
+        }
+#endif /* PCA_ENABLE_DNSSD */
 
-        for (i = 0; i < nr_fds; i++) {
-            fds[i] = (int)sorted_array_get(the_server.fd2clients, i, NULL);
+        SockClient *client = (SockClient *)cli_node;
+        if (client->ct != CT_UNIX_SOCKET && client->ct != CT_INET_SOCKET) {
+            purc_log_error("Bad socket type (%d): %s\n",
+                    client->ct, strerror(errno));
+            goto error;
         }
 
-        for (i = 0; i < nr_fds; i++) {
-            int fd = fds[i];
-            void *cli_node;
-
-            if (FD_ISSET(fd, rsetptr)) {
-                sorted_array_find(the_server.fd2clients, (uint64_t)fd, &cli_node);
-                if (cli_node == PTR_FOR_US_LISTENER) {
-                    USClient * client = us_handle_accept(the_server.us_srv);
-                    if (client == NULL) {
-                        purc_log_info("Refused a client\n");
-                    }
-                    else if (listen_new_client(client->fd, client, FALSE)) {
-                        purc_log_error("Failed epoll_ctl for connected unix socket (%d): %s\n",
-                                client->fd, strerror(errno));
-                        goto error;
-                    }
-                }
-                else if (cli_node == PTR_FOR_WS_LISTENER) {
-                    WSClient * client = ws_handle_accept(the_server.ws_srv, the_server.ws_listener);
-                    if (client == NULL) {
-                        purc_log_info("Refused a client\n");
-                    }
-                    else if (listen_new_client(client->fd, client, FALSE)) {
-                        purc_log_error("Failed epoll_ctl for connected web socket (%d): %s\n",
-                                client->fd, strerror(errno));
-                        goto error;
-                    }
-                }
-#if PCA_ENABLE_DNSSD
-                else if (cli_node == PTR_FOR_DNSSD_LISTENER) {
-                    purc_dnssd_process_result(the_server.dnssd);
-                }
-#endif /* PCA_ENABLE_DNSSD */
-                else {
-                    USClient *usc = (USClient *)cli_node;
-                    if (usc->ct == CT_UNIX_SOCKET) {
-                        if (usc->entity) {
-                            purcmc_endpoint *endpoint = container_of(usc->entity,
-                                    purcmc_endpoint, entity);
-                            update_endpoint_living_time(&the_server, endpoint);
-                        }
-
-                        us_handle_reads(the_server.us_srv, usc);
-                    }
-                    else if (usc->ct == CT_INET_SOCKET) {
-                        WSClient *wsc = (WSClient *)cli_node;
-                        if (wsc->entity) {
-                            purcmc_endpoint *endpoint = container_of(usc->entity,
-                                    purcmc_endpoint, entity);
-                            update_endpoint_living_time(&the_server, endpoint);
-                        }
-
-                        ws_handle_reads(the_server.ws_srv, wsc);
-                    }
-                    else {
-                        purc_log_error("Bad socket type (%d): %s\n",
-                                usc->ct, strerror(errno));
-                        goto error;
-                    }
-                }
+        if (revents & (POLLIN | POLLHUP | POLLERR)) {
+            if (client->entity) {
+                purcmc_endpoint *endpoint = container_of(client->entity,
+                        purcmc_endpoint, entity);
+                update_endpoint_living_time(&the_server, endpoint);
             }
 
-            if (FD_ISSET(fd, wsetptr)) {
-                if (cli_node == PTR_FOR_US_LISTENER ||
-                        cli_node == PTR_FOR_WS_LISTENER) {
-                    assert(0);
-                }
-                else {
-                    USClient *usc = (USClient *)cli_node;
-                    if (usc->ct == CT_UNIX_SOCKET) {
-                        us_handle_writes(the_server.us_srv, usc);
+            if (client->ct == CT_UNIX_SOCKET)
+                us_handle_reads(the_server.us_srv, (USClient *)client);
+            else
+                ws_handle_reads(the_server.ws_srv, (WSClient *)client);
 
-                        if (!(usc->status & US_SENDING) &&
-                                !(usc->status & US_CLOSE)) {
-                            FD_CLR(fd, &the_server.wfdset);
-                        }
-                    }
-                    else if (usc->ct == CT_INET_SOCKET) {
-                        WSClient *wsc = (WSClient *)cli_node;
-                        ws_handle_writes(the_server.ws_srv, wsc);
+            /* the client may have been closed */
+            if (find_listening_client(fd) != cli_node)
+                continue;
+        }
 
-                        if (!(wsc->status & WS_SENDING) &&
-                                !(wsc->status & WS_CLOSE)) {
-                            FD_CLR(fd, &the_server.wfdset);
-                        }
-                    }
-                }
+        if (revents & POLLOUT) {
+            bool done;
+
+            if (client->ct == CT_UNIX_SOCKET) {
+                USClient *usc = (USClient *)client;
+                us_handle_writes(the_server.us_srv, usc);
+                if (find_listening_client(fd) != cli_node)
+                    continue;
+                done = !(usc->status & US_SENDING) &&
+                        !(usc->status & US_CLOSE);
+            }
+            else {
+                WSClient *wsc = (WSClient *)client;
+                ws_handle_writes(the_server.ws_srv, wsc);
+                if (find_listening_client(fd) != cli_node)
+                    continue;
+                done = !(wsc->status & WS_SENDING) &&
+                        !(wsc->status & WS_CLOSE);
             }
+
+            if (done)
+                listen_for_writing(fd, false);
         }
     }
 
@@ -729,7 +885,7 @@ error:
     return false;
 }
 
-#endif /* HAVE(SYS_SELECT_H) */
+#endif /* HAVE(POLL_H) */
 
 static int
 comp_living_time(const void *k1, const void *k2, void *ptr)
@@ -741,17 +897,6 @@ comp_living_time(const void *k1, const void *k2, void *ptr)
     return e1->t_living - e2->t_living;
 }
 
-#if !HAVE(SYS_EPOLL_H) && HAVE(SYS_SELECT_H)
-static int
-intcmp(uint64_t sortv1, uint64_t sortv2)
-{
-    int fd1 = (int)sortv1;
-    int fd2 = (int)sortv2;
-
-    return fd1 - fd2;
-}
-#endif
-
 static int
 init_server(void)
 {
@@ -777,15 +922,11 @@ init_server(void)
         purc_enable_log_ex(PURC_LOG_MASK_DEFAULT, PURC_LOG_FACILITY_STDOUT);
     }
 
-#if !HAVE(SYS_EPOLL_H) && HAVE(SYS_SELECT_H)
-    the_server.maxfd = -1;
-    the_server.fd2clients = sorted_array_create(SAFLAG_DEFAULT, 4, NULL,
-            intcmp);
-    if (the_server.fd2clients == NULL)
-        return -1;
-
-    FD_ZERO(&the_server.rfdset);
-    FD_ZERO(&the_server.wfdset);
+#if !HAVE(SYS_EPOLL_H) && HAVE(POLL_H)
+    the_server.pollfds = NULL;
+    the_server.nr_pollfds = the_server.sz_pollfds = 0;
+    the_server.fd2slots = NULL;
+    the_server.sz_fd2slots = 0;
 #endif
 
     if (the_srvcfg->unixsocket == NULL) {
@@ -808,6 +949,30 @@ init_server(void)
         the_srvcfg->backlog = SOMAXCONN;
     }
 
+    if (the_srvcfg->deflate_wbits == 0) {
+        the_srvcfg->deflate_wbits = WS_DEFLATE_MAX_WBITS;
+    }
+    else if (the_srvcfg->deflate_wbits < WS_DEFLATE_MIN_WBITS) {
+        the_srvcfg->deflate_wbits = WS_DEFLATE_MIN_WBITS;
+    }
+    else if (the_srvcfg->deflate_wbits > WS_DEFLATE_MAX_WBITS) {
+        the_srvcfg->deflate_wbits = WS_DEFLATE_MAX_WBITS;
+    }
+
+    if (the_srvcfg->deflate_min_size <= 0) {
+        the_srvcfg->deflate_min_size = WS_DEFLATE_MIN_SIZE;
+    }
+
+#if HAVE(LIBSSL)
+    if (the_srvcfg->tls_workers == 0) {
+        the_srvcfg->tls_workers = WS_TLS_DEF_WORKERS;
+    }
+    else if (the_srvcfg->tls_workers < 0) {
+        /* do the TLS handshakes on the main thread */
+        the_srvcfg->tls_workers = 0;
+    }
+#endif
+
     if (the_srvcfg->name == NULL) {
         the_srvcfg->name = g_strdup(DEFAULT_NAME);
     }
@@ -827,6 +992,13 @@ init_server(void)
     kvlist_init(&the_server.dnssd_rdr_list, NULL);
     avl_init(&the_server.living_avl, comp_living_time, true, NULL);
 
+    the_server.doc_cache = doc_cache_new(DOC_CACHE_MAX_SIZE,
+            DOC_CACHE_MAX_ENTRIES);
+    if (the_server.doc_cache == NULL) {
+        purc_log_error("Failed to create the document cache\n");
+        return -1;
+    }
+
     return 0;
 }
 
@@ -837,8 +1009,9 @@ deinit_server(void)
     void *next, *data;
     purcmc_endpoint *endpoint, *tmp;
 
-#if !HAVE(SYS_EPOLL_H) && HAVE(SYS_SELECT_H)
-    sorted_array_destroy(the_server.fd2clients);
+#if !HAVE(SYS_EPOLL_H) && HAVE(POLL_H)
+    free(the_server.pollfds);
+    free(the_server.fd2slots);
 #endif
 
     avl_remove_all_elements(&the_server.living_avl, endpoint, avl, tmp) {
@@ -879,6 +1052,11 @@ deinit_server(void)
 
     kvlist_free(&the_server.endpoint_list);
 
+    if (the_server.doc_cache) {
+        doc_cache_delete(the_server.doc_cache);
+        the_server.doc_cache = NULL;
+    }
+
     if (the_server.dangling_endpoints) {
         gs_list* node = the_server.dangling_endpoints;
 
@@ -29,10 +29,10 @@
 #include <unistd.h>
 #if HAVE(SYS_EPOLL_H)
 #include <sys/epoll.h>
-#elif HAVE(SYS_SELECT_H)
-#include <sys/select.h>
+#elif HAVE(POLL_H)
+#include <poll.h>
 #else
-#error no `epoll` either `select` found.
+#error no `epoll` either `poll` found.
 #endif
 
 #include <purc/purc-pcrdr.h>
@@ -167,8 +167,19 @@ struct dnssd_rdr {
     time_t  last_update_at; // monotoic_time_ms
 };
 
+#if !HAVE(SYS_EPOLL_H) && HAVE(POLL_H)
+/* A slot in the fd table for poll */
+struct poll_slot {
+    /* the listener pointer or the client; NULL if not used */
+    void           *ptr;
+    /* the index in the pollfd array */
+    unsigned int    idx;
+};
+#endif
+
 struct WSServer_;
 struct USServer_;
+struct doc_cache;
 
 /* The PurcMC purcmc_server */
 struct purcmc_server
@@ -178,11 +189,13 @@ struct purcmc_server
     int ws_listener;
 #if HAVE(SYS_EPOLL_H)
     int epollfd;
-#elif HAVE(SYS_SELECT_H)
-    int maxfd;
-    fd_set rfdset, wfdset;
-    /* the AVL tree for the map from fd to client */
-    struct sorted_array *fd2clients;
+#elif HAVE(POLL_H)
+    /* the dense array of the fds to poll */
+    struct pollfd *pollfds;
+    unsigned int nr_pollfds, sz_pollfds;
+    /* the table indexed by fd for the listeners and clients */
+    struct poll_slot *fd2slots;
+    unsigned int sz_fd2slots;
 #endif
     unsigned int nr_endpoints;
     bool running;
@@ -220,6 +233,9 @@ struct purcmc_server
     /* The session list */
     gs_list *sess_list;
 
+    /* The documents loaded with their content hashes */
+    struct doc_cache *doc_cache;
+
     /* the user data */
     void *user_data;
 
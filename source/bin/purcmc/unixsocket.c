@@ -20,6 +20,7 @@
 ** along with this program.  If not, see http://www.gnu.org/licenses/.
 */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -79,6 +80,13 @@ int us_listen (USServer* server)
 
     fcntl (fd, F_SETFD, FD_CLOEXEC);
 
+    /* the listener is drained in a loop, so it must not block */
+    if (fcntl (fd, F_SETFL, fcntl (fd, F_GETFL, 0) | O_NONBLOCK) == -1) {
+        purc_log_error ("Error duing calling `fcntl` in us_listen: %s\n",
+                strerror (errno));
+        goto error;
+    }
+
     /* fill in socket address structure */
     memset (&unix_addr, 0, sizeof(unix_addr));
     unix_addr.sun_family = AF_UNIX;
@@ -118,7 +126,8 @@ error:
  * We also obtain the client's pid from the pathname
  * that it must bind before calling us.
  */
-/* returns new fd if all OK, < 0 on error */
+/* returns new fd if all OK, -1 if no connection accepted,
+   -2 if the connection was accepted but rejected */
 static int us_accept (int listenfd, pid_t *pidptr, uid_t *uidptr)
 {
     int                clifd;
@@ -129,10 +138,18 @@ static int us_accept (int listenfd, pid_t *pidptr, uid_t *uidptr)
     const char*        pid_str;
 
     len = sizeof (unix_addr);
+#if HAVE(ACCEPT4)
+    if ((clifd = accept4 (listenfd, (struct sockaddr *) &unix_addr, &len,
+                    SOCK_NONBLOCK | SOCK_CLOEXEC)) < 0)
+        return (-1);        /* often errno=EAGAIN or EINTR */
+#else
     if ((clifd = accept (listenfd, (struct sockaddr *) &unix_addr, &len)) < 0)
         return (-1);        /* often errno=EINTR, if signal caught */
 
     fcntl (clifd, F_SETFD, FD_CLOEXEC);
+    /* the client is watched in the edge-triggered mode */
+    fcntl (clifd, F_SETFL, fcntl (clifd, F_GETFL, 0) | O_NONBLOCK);
+#endif
 
     /* obtain the client's uid from its calling address */
     len -= sizeof(unix_addr.sun_family);
@@ -181,7 +198,7 @@ static int us_accept (int listenfd, pid_t *pidptr, uid_t *uidptr)
 
 error:
     close (clifd);
-    return -1;
+    return -2;
 }
 
 /* Set the given file descriptor as NON BLOCKING. */
@@ -197,33 +214,47 @@ set_nonblocking (int sock)
     return 0;
 }
 
-/* Handle a new UNIX socket connection. */
+/*
+ * Handle a new UNIX socket connection.
+ *
+ * `*retv` is set to 0 if a pending connection was handled (accepted or
+ * refused), or -1 if there is no pending connection or accept() failed.
+ */
 USClient *
-us_handle_accept (USServer* server)
+us_handle_accept (USServer* server, int *retv)
 {
     USClient *usc = NULL;
     pid_t pid;
     uid_t uid;
     int newfd = -1;
 
+    *retv = 0;
+    newfd = us_accept (server->listener, &pid, &uid);
+    if (newfd < 0) {
+        if (newfd == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                purc_log_error ("Failed to accept Unix socket: %s\n",
+                        strerror (errno));
+            *retv = -1;
+        }
+        return NULL;
+    }
+
     usc = (USClient *)calloc (sizeof (USClient), 1);
     if (usc == NULL) {
         purc_log_error ("Failed to callocate memory for Unix socket client\n");
+        close (newfd);
         return NULL;
     }
 
     list_head_init (&usc->pending);
     usc->sz_pending = 0;
 
-    newfd = us_accept (server->listener, &pid, &uid);
-    if (newfd < 0) {
-        purc_log_error ("Failed to accept Unix socket: %d\n", newfd);
-        goto failed;
-    }
-
+#if !HAVE(ACCEPT4)
     if (set_nonblocking (newfd)) {
-        goto cleanup;
+        goto failed;
     }
+#endif
 
     usc->ct = CT_UNIX_SOCKET;
     usc->fd = newfd;
@@ -257,9 +288,12 @@ cleanup:
     us_cleanup_client (server, usc);
     return NULL;
 
+#if !HAVE(ACCEPT4)
 failed:
+    close (newfd);
     free (usc);
     return NULL;
+#endif
 }
 
 /*
@@ -493,6 +527,8 @@ int us_handle_reads (USServer* server, USClient* usc)
     int retv, err_code = 0, sta_code = 0;
     ssize_t n = 0;
 
+    usc->status &= ~US_DRAINED;
+
     /* if it is not waiting for payload, read a frame header */
     if (usc->status & US_WATING_FOR_PAYLOAD) {
 
@@ -511,7 +547,19 @@ int us_handle_reads (USServer* server, USClient* usc)
         }
     }
     else {
-        n = my_read (usc->fd, &usc->header, sizeof (USFrameHeader));
+        n = read (usc->fd, &usc->header, sizeof (USFrameHeader));
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            /* nothing left to read from the edge-triggered socket */
+            usc->status |= US_DRAINED;
+            goto done;
+        }
+        else if (n > 0 && n < (ssize_t)sizeof (USFrameHeader)) {
+            ssize_t m = my_read (usc->fd, (char *)&usc->header + n,
+                    sizeof (USFrameHeader) - n);
+            if (m > 0)
+                n += m;
+        }
+
         if (n < (ssize_t)sizeof (USFrameHeader)) {
             purc_log_error ("Failed to read frame header from Unix socket.\n");
             err_code = PCRDR_ERROR_IO;
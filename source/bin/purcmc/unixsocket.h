@@ -56,6 +56,7 @@ typedef enum USSTATUS {
     US_SENDING = (1 << 3),
     US_THROTTLING = (1 << 4),
     US_WATING_FOR_PAYLOAD = (1 << 5),
+    US_DRAINED = (1 << 6),      /* the last read found nothing to read */
 } USStatus;
 
 typedef struct USPendingData_ {
@@ -121,7 +122,7 @@ USServer *us_init (const purcmc_server_config* config);
 int us_listen (USServer* server);
 void us_stop (USServer *server);
 
-USClient *us_handle_accept (USServer *server);
+USClient *us_handle_accept (USServer *server, int *retv);
 int us_handle_reads (USServer *server, USClient* usc);
 int us_handle_writes (USServer *server, USClient *usc);
 int us_remove_dangling_client (USServer * server, USClient *usc);
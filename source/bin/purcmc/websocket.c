@@ -28,6 +28,7 @@
  * SOFTWARE.
  */
 
+#define _GNU_SOURCE
 #include <config.h>
 
 #include <stdio.h>
@@ -84,6 +85,10 @@ static const uint8_t utf8d[] = {
 static void handle_ws_read_close (WSServer * server, WSClient * client);
 #if HAVE(LIBSSL)
 static int shutdown_ssl (WSClient * client);
+static void ws_tls_handshake_worker (gpointer data, gpointer user_data);
+#endif
+#if HAVE(ZLIB)
+static void ws_free_deflate (WSClient * client);
 #endif
 
 /* Determine if the given string is valid UTF-8.
@@ -351,6 +356,10 @@ ws_free_header_fields (WSHeaders * headers)
     free (headers->ws_resp);
   if (headers->ws_sock_ver)
     free (headers->ws_sock_ver);
+  if (headers->ws_extensions)
+    free (headers->ws_extensions);
+  if (headers->ws_ext_resp)
+    free (headers->ws_ext_resp);
   if (headers->referer)
     free (headers->referer);
 }
@@ -409,9 +418,40 @@ ws_shutdown_dangling_clients (WSClient * client)
 static void
 ws_ssl_cleanup (WSServer * server)
 {
+  WSTLSStats *stats = &server->tls_stats;
+  WSClient *client;
+
   if (!server->config->use_ssl)
     return;
 
+  if (server->tls_pool) {
+    /* wait for the handshakes in progress */
+    g_thread_pool_free (server->tls_pool, FALSE, TRUE);
+    server->tls_pool = NULL;
+
+    while ((client = g_async_queue_try_pop (server->tls_done))) {
+      ws_remove_dangling_client (server, client);
+      close (client->fd);
+      free (client);
+    }
+    g_async_queue_unref (server->tls_done);
+    server->tls_done = NULL;
+  }
+
+  if (stats->nr_handshakes || stats->nr_failed) {
+    double secs = (stats->last_ns - stats->first_ns) / 1e9;
+
+    purc_log_info ("TLS: %llu handshakes (%llu resumed, %llu failed), "
+                   "%.1f handshakes/s, %llu us on workers, "
+                   "main thread stalled %llu us\n",
+                   (unsigned long long) stats->nr_handshakes,
+                   (unsigned long long) stats->nr_resumed,
+                   (unsigned long long) stats->nr_failed,
+                   secs > 0 ? stats->nr_handshakes / secs : 0.0,
+                   (unsigned long long) stats->worker_ns / 1000,
+                   (unsigned long long) stats->main_ns / 1000);
+  }
+
   if (server->ctx)
     SSL_CTX_free (server->ctx);
 
@@ -441,6 +481,9 @@ ws_remove_dangling_client (WSServer * server, WSClient *client)
   if (client->ssl)
     ws_shutdown_dangling_clients (client);
 #endif
+#if HAVE(ZLIB)
+  ws_free_deflate (client);
+#endif
 
   server->nr_clients--;
   assert (server->nr_clients >= 0);
@@ -524,6 +567,27 @@ ws_initialize_ssl_ctx (WSServer * server)
   SSL_CTX_set_mode (ctx, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER |
                     SSL_MODE_ENABLE_PARTIAL_WRITE);
 
+  /* let reconnecting clients resume their sessions by tickets, or by
+   * session ids for the clients without the support for tickets */
+  SSL_CTX_set_session_id_context (ctx, (const unsigned char *) "purcmc",
+                                  sizeof ("purcmc") - 1);
+  SSL_CTX_set_session_cache_mode (ctx, SSL_SESS_CACHE_SERVER);
+  if (server->config->notlstickets)
+    SSL_CTX_set_options (ctx, SSL_OP_NO_TICKET);
+  else
+    SSL_CTX_clear_options (ctx, SSL_OP_NO_TICKET);
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+  /* OpenSSL is thread-safe without the locking callbacks since 1.1.0 */
+  if (server->config->tls_workers > 0) {
+    server->tls_pool = g_thread_pool_new (ws_tls_handshake_worker, server,
+                                          server->config->tls_workers,
+                                          FALSE, NULL);
+    if (server->tls_pool)
+      server->tls_done = g_async_queue_new ();
+  }
+#endif
+
   server->ctx = ctx;
   ret = 0;
 out:
@@ -691,9 +755,100 @@ handle_accept_ssl (WSServer * server, WSClient * client)
   }
 }
 
+/* Get the monotonic time in nanoseconds. */
+static uint64_t
+ws_monotonic_ns (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Account a completed handshake in the statistics. */
+static void
+ws_tls_account (WSServer * server, WSClient * client)
+{
+  WSTLSStats *stats = &server->tls_stats;
+
+  stats->nr_handshakes++;
+  if (SSL_session_reused (client->ssl))
+    stats->nr_resumed++;
+  stats->worker_ns += client->ssl_handshake_ns;
+  stats->last_ns = ws_monotonic_ns ();
+}
+
+/* Do one step of the TLS handshake for a client on a worker thread.
+ *
+ * The worker never waits on the socket: SSL_accept is called once and
+ * the result is left in ssl_step for the main thread, which requeues the
+ * client when the socket is ready again. The client is not touched by
+ * the main thread until it is popped from the done queue. */
+static void
+ws_tls_handshake_worker (gpointer data, gpointer user_data)
+{
+  WSClient *client = data;
+  WSServer *server = user_data;
+  uint64_t t_start = ws_monotonic_ns ();
+  int ret, err;
+
+  if ((ret = SSL_accept (client->ssl)) > 0)
+    client->ssl_step = WS_TLS_STEP_DONE;
+  else {
+    err = SSL_get_error (client->ssl, ret);
+    if (err == SSL_ERROR_WANT_READ)
+      client->ssl_step = WS_TLS_STEP_WANT_READ;
+    else if (err == SSL_ERROR_WANT_WRITE)
+      client->ssl_step = WS_TLS_STEP_WANT_WRITE;
+    else if (err == SSL_ERROR_SYSCALL && ret < 0 &&
+             (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+      client->ssl_step = WS_TLS_STEP_WANT_READ;
+    else {
+      log_return_message (ret, err, "SSL_accept");
+      client->ssl_step = WS_TLS_STEP_FAILED;
+    }
+  }
+
+  client->ssl_handshake_ns += ws_monotonic_ns () - t_start;
+  g_async_queue_push (server->tls_done, client);
+}
+
+/* Hand the TLS handshake of a client over to the workers.
+ *
+ * On error, 1 is returned and the handshake should be done in place. */
+static int
+ws_offload_accept_ssl (WSServer * server, WSClient * client)
+{
+  if (!client->ssl) {
+    if (!(client->ssl = SSL_new (server->ctx))) {
+      purc_log_info ("SSL: SSL_new, new SSL structure failed.\n");
+      return 1;
+    }
+    if (!SSL_set_fd (client->ssl, client->fd)) {
+      purc_log_info ("SSL: unable to set file descriptor\n");
+      return 1;
+    }
+  }
+
+  if (server->tls_stats.first_ns == 0)
+    server->tls_stats.first_ns = ws_monotonic_ns ();
+
+  client->sslstatus |= WS_TLS_OFFLOADED;
+  if (!g_thread_pool_push (server->tls_pool, client, NULL)) {
+    client->sslstatus &= ~WS_TLS_OFFLOADED;
+    return 1;
+  }
+
+  if (server->on_tls_offload)
+    server->on_tls_offload (server, (SockClient *)client, 1);
+  return 0;
+}
+
 /* Given the current status of the SSL buffer, perform that action.
  *
  * On error or if no SSL pending status, 1 is returned.
+ * If the client has been cleaned up or is closing, -1 is returned and
+ * the client must not be touched by the caller.
  * On success, the TLS/SSL pending action is called and 0 is returned */
 static int
 handle_ssl_pending_rw (WSServer * server, WSClient * client)
@@ -701,25 +856,50 @@ handle_ssl_pending_rw (WSServer * server, WSClient * client)
   if (!server->config->use_ssl)
     return 1;
 
+  /* the handshake is in progress on a worker */
+  if (client->sslstatus & WS_TLS_OFFLOADED)
+    return 0;
+
   /* trying to write but still waiting for a successful SSL_accept */
   if (client->sslstatus & WS_TLS_ACCEPTING) {
-    handle_accept_ssl (server, client);
+    uint64_t t_start = ws_monotonic_ns ();
+
+    if (server->tls_pool == NULL || ws_offload_accept_ssl (server, client)) {
+      if (server->tls_stats.first_ns == 0)
+        server->tls_stats.first_ns = t_start;
+
+      handle_accept_ssl (server, client);
+      if (client->status & WS_CLOSE)
+        server->tls_stats.nr_failed++;
+      else if (!(client->sslstatus & WS_TLS_ACCEPTING) && client->ssl)
+        ws_tls_account (server, client);
+    }
+
+    server->tls_stats.main_ns += ws_monotonic_ns () - t_start;
+    if (client->status & WS_CLOSE) {
+      handle_ws_read_close (server, client);
+      return -1;
+    }
     return 0;
   }
   /* trying to read but still waiting for a successful SSL_read */
   if (client->sslstatus & WS_TLS_READING) {
-    ws_handle_reads (server, client);
+    if (ws_handle_reads (server, client) < 0)
+      return -1;
     return 0;
   }
   /* trying to write but still waiting for a successful SSL_write */
   if (client->sslstatus & WS_TLS_WRITING) {
-    ws_handle_writes (server, client);
+    if (ws_handle_writes (server, client) < 0)
+      return -1;
     return 0;
   }
   /* trying to write but still waiting for a successful SSL_shutdown */
   if (client->sslstatus & WS_TLS_SHUTTING) {
-    if (shutdown_ssl (client) == 0)
+    if (shutdown_ssl (client) == 0) {
       handle_ws_read_close (server, client);
+      return -1;
+    }
     return 0;
   }
 
@@ -791,11 +971,15 @@ read_ssl_socket (WSClient * client, char *buffer, int size)
       done = 1;
       break;
     case SSL_ERROR_WANT_READ:
+      client->drained = 1;
       done = 1;
       break;
     case SSL_ERROR_SYSCALL:
-      if ((bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)))
+      if ((bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))) {
+        if (errno != EINTR)
+          client->drained = 1;
         break;
+      }
     case SSL_ERROR_ZERO_RETURN:
     case SSL_ERROR_WANT_X509_LOOKUP:
     default:
@@ -828,7 +1012,8 @@ set_nonblocking (int sock)
 /* Accept a new connection on a socket and add it to the list of
  * current connected clients.
  *
- * The newly assigned socket is returned. */
+ * On error, or if there is no pending connection, NULL is returned.
+ * On success, the newly assigned client is returned. */
 static WSClient *
 accept_client (int listener /*, GSLList ** colist */)
 {
@@ -839,13 +1024,16 @@ accept_client (int listener /*, GSLList ** colist */)
   socklen_t alen;
 
   alen = sizeof (raddr);
-  if ((newfd = accept (listener, (struct sockaddr *) &raddr, &alen)) == -1)
-    purc_log_error ("Unable to set accept: %s.", strerror (errno));
-
-  fcntl (newfd, F_SETFD, FD_CLOEXEC);
+#if HAVE(ACCEPT4)
+  newfd = accept4 (listener, (struct sockaddr *) &raddr, &alen,
+                   SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+  newfd = accept (listener, (struct sockaddr *) &raddr, &alen);
+#endif
 
   if (newfd == -1) {
-    purc_log_info ("Unable to accept: %s.", strerror (errno));
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+      purc_log_error ("Unable to accept: %s.", strerror (errno));
     return NULL;
   }
   src = ws_get_raddr ((struct sockaddr *) &raddr);
@@ -855,8 +1043,12 @@ accept_client (int listener /*, GSLList ** colist */)
   client->fd = newfd;
   inet_ntop (raddr.ss_family, src, client->remote_ip, INET6_ADDRSTRLEN);
 
+#if !HAVE(ACCEPT4)
+  fcntl (newfd, F_SETFD, FD_CLOEXEC);
+
   /* make the socket non-blocking */
   set_nonblocking (client->fd);
+#endif
 
   return client;
 }
@@ -930,6 +1122,15 @@ ws_set_header_key_value (WSHeaders * headers, char *key, char *value)
     headers->ws_key = strdup (value);
   else if (strcasecmp ("Sec-WebSocket-Version", key) == 0)
     headers->ws_sock_ver = strdup (value);
+  else if (strcasecmp ("Sec-WebSocket-Extensions", key) == 0) {
+    /* the header field may appear multiple times */
+    if (headers->ws_extensions) {
+      ws_append_str (&headers->ws_extensions, ", ");
+      ws_append_str (&headers->ws_extensions, value);
+    }
+    else
+      headers->ws_extensions = strdup (value);
+  }
   else if (strcasecmp ("User-Agent", key) == 0)
     headers->agent = strdup (value);
   else if (strcasecmp ("Referer", key) == 0)
@@ -1084,8 +1285,10 @@ read_plain_socket (WSClient * client, char *buffer, int size)
 
   bytes = recv (client->fd, buffer, size, 0);
 
-  if (bytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+  if (bytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    client->drained = 1;
     return ws_set_status (client, WS_READING, bytes);
+  }
   else if (bytes == -1 || bytes == 0)
     return ws_set_status (client, WS_ERR | WS_CLOSE, bytes);
 
@@ -1243,12 +1446,365 @@ ws_respond (WSServer * server, WSClient * client, const char *buffer, int len)
   return bytes;
 }
 
+#if HAVE(ZLIB)
+/* Get the CPU time consumed by the calling thread in nanoseconds. */
+static uint64_t
+ws_thread_cputime_ns (void)
+{
+  struct timespec ts;
+
+  if (clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+    return 0;
+
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Strip the leading and trailing white spaces of the given string in
+ * place.
+ *
+ * The stripped string is returned. */
+static char *
+ws_strip_spaces (char *str)
+{
+  char *end;
+
+  while (isspace ((unsigned char) *str))
+    str++;
+
+  end = str + strlen (str);
+  while (end > str && isspace ((unsigned char) *(end - 1)))
+    end--;
+  *end = '\0';
+
+  return str;
+}
+
+/* Parse the value of a `*_max_window_bits` extension parameter.
+ *
+ * On error, -1 is returned.
+ * On success, the window bits (8~15) is returned. */
+static int
+ws_parse_wbits (const char *value)
+{
+  char buf[4];
+  size_t len = strlen (value);
+  int bits;
+
+  /* the value may be a quoted-string */
+  if (len >= 2 && value[0] == '"' && value[len - 1] == '"') {
+    value++;
+    len -= 2;
+  }
+
+  if (len == 0 || len >= sizeof (buf))
+    return -1;
+
+  memcpy (buf, value, len);
+  buf[len] = '\0';
+  if (!isdigit ((unsigned char) buf[0]) ||
+      (len == 2 && !isdigit ((unsigned char) buf[1])))
+    return -1;
+
+  bits = atoi (buf);
+  if (bits < 8 || bits > WS_DEFLATE_MAX_WBITS)
+    return -1;
+
+  return bits;
+}
+
+/* Check a single permessage-deflate offer of the client against our
+ * configuration (RFC 7692, Section 7.1).
+ *
+ * On error, or if the offer is not acceptable, 1 is returned.
+ * On success, the agreed parameters are set and 0 is returned. */
+static int
+ws_parse_deflate_offer (WSServer * server, char *offer, WSDeflate * dfl)
+{
+  char *saveptr = NULL, *param, *name, *value;
+  int nr_params = 0, bits;
+
+  dfl->server_wbits = server->config->deflate_wbits;
+  dfl->server_no_ctx_takeover = server->config->deflate_no_ctx_takeover;
+  dfl->client_no_ctx_takeover = 0;
+
+  for (param = strtok_r (offer, ";", &saveptr); param != NULL;
+       param = strtok_r (NULL, ";", &saveptr), nr_params++) {
+    if ((value = strchr (param, '=')) != NULL) {
+      *value++ = '\0';
+      value = ws_strip_spaces (value);
+    }
+    name = ws_strip_spaces (param);
+
+    if (nr_params == 0) {
+      if (strcasecmp (name, WS_DEFLATE_EXT_NAME) != 0 || value)
+        return 1;
+    }
+    else if (strcasecmp (name, "server_no_context_takeover") == 0) {
+      if (value)
+        return 1;
+      dfl->server_no_ctx_takeover = 1;
+    }
+    else if (strcasecmp (name, "client_no_context_takeover") == 0) {
+      if (value)
+        return 1;
+      dfl->client_no_ctx_takeover = 1;
+    }
+    else if (strcasecmp (name, "server_max_window_bits") == 0) {
+      if (value == NULL || (bits = ws_parse_wbits (value)) < 0)
+        return 1;
+      /* zlib does not support a raw deflate stream with 8 window bits */
+      if (bits < WS_DEFLATE_MIN_WBITS)
+        return 1;
+      if (bits < dfl->server_wbits)
+        dfl->server_wbits = bits;
+    }
+    else if (strcasecmp (name, "client_max_window_bits") == 0) {
+      /* we always inflate with the maximal window, so just validate it */
+      if (value && ws_parse_wbits (value) < 0)
+        return 1;
+    }
+    else {
+      /* unknown extension parameter */
+      return 1;
+    }
+  }
+
+  return (nr_params > 0) ? 0 : 1;
+}
+
+/* Negotiate the permessage-deflate extension with the offers listed in
+ * the `Sec-WebSocket-Extensions` request header.
+ *
+ * On success, the compression context of the client is created and
+ * the response header value is set. */
+static void
+ws_negotiate_deflate (WSServer * server, WSClient * client, WSHeaders * headers)
+{
+  char *exts, *offer, *saveptr = NULL;
+  char resp[128];
+  WSDeflate *dfl;
+  int found = 0;
+
+  if (server->config->nodeflate || headers->ws_extensions == NULL)
+    return;
+
+  if ((dfl = calloc (1, sizeof (WSDeflate))) == NULL)
+    return;
+
+  /* pick the first acceptable offer */
+  exts = strdup (headers->ws_extensions);
+  for (offer = strtok_r (exts, ",", &saveptr); offer != NULL;
+       offer = strtok_r (NULL, ",", &saveptr)) {
+    if (ws_parse_deflate_offer (server, offer, dfl) == 0) {
+      found = 1;
+      break;
+    }
+  }
+  free (exts);
+
+  if (!found)
+    goto failed;
+
+  if (deflateInit2 (&dfl->deflater, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                    -dfl->server_wbits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    goto failed;
+
+  if (inflateInit2 (&dfl->inflater, -WS_DEFLATE_MAX_WBITS) != Z_OK) {
+    deflateEnd (&dfl->deflater);
+    goto failed;
+  }
+
+  snprintf (resp, sizeof (resp), "%s; server_max_window_bits=%d%s%s",
+            WS_DEFLATE_EXT_NAME, dfl->server_wbits,
+            dfl->server_no_ctx_takeover ? "; server_no_context_takeover" : "",
+            dfl->client_no_ctx_takeover ? "; client_no_context_takeover" : "");
+  headers->ws_ext_resp = strdup (resp);
+  client->deflate = dfl;
+  return;
+
+failed:
+  free (dfl);
+}
+
+/* Report the compression statistics of the given client, and release
+ * the compression context. */
+static void
+ws_free_deflate (WSClient * client)
+{
+  WSDeflate *dfl = client->deflate;
+
+  if (dfl == NULL)
+    return;
+
+  purc_log_info ("permessage-deflate %d %s: "
+                 "sent %llu msgs, %llu -> %llu bytes (ratio %.2f), %llu us; "
+                 "recv %llu msgs, %llu -> %llu bytes (ratio %.2f), %llu us\n",
+                 client->fd, client->remote_ip,
+                 (unsigned long long) dfl->nr_deflated,
+                 (unsigned long long) dfl->sz_deflate_in,
+                 (unsigned long long) dfl->sz_deflate_out,
+                 dfl->sz_deflate_out ?
+                 (double) dfl->sz_deflate_in / dfl->sz_deflate_out : 0.0,
+                 (unsigned long long) (dfl->ns_deflate / 1000),
+                 (unsigned long long) dfl->nr_inflated,
+                 (unsigned long long) dfl->sz_inflate_in,
+                 (unsigned long long) dfl->sz_inflate_out,
+                 dfl->sz_inflate_in ?
+                 (double) dfl->sz_inflate_out / dfl->sz_inflate_in : 0.0,
+                 (unsigned long long) (dfl->ns_inflate / 1000));
+
+  deflateEnd (&dfl->deflater);
+  inflateEnd (&dfl->inflater);
+  free (dfl);
+  client->deflate = NULL;
+}
+
+/* Compress a whole message with the negotiated deflater.
+ *
+ * On error, or if the message is not compressible, NULL is returned.
+ * On success, a malloc'd buffer is returned and its size is set. */
+static char *
+ws_deflate_message (WSClient * client, const char *p, int sz, int *zsz)
+{
+  WSDeflate *dfl = client->deflate;
+  z_stream *zs = &dfl->deflater;
+  uint64_t t_start = ws_thread_cputime_ns ();
+  size_t len = 0, cap;
+  char *buf, *tmp;
+  int ret;
+
+  cap = deflateBound (zs, sz) + 8;
+  if ((buf = malloc (cap)) == NULL)
+    return NULL;
+
+  zs->next_in = (Bytef *) p;
+  zs->avail_in = sz;
+  do {
+    if (len == cap) {
+      cap *= 2;
+      if ((tmp = realloc (buf, cap)) == NULL)
+        goto failed;
+      buf = tmp;
+    }
+
+    zs->next_out = (Bytef *) buf + len;
+    zs->avail_out = cap - len;
+    ret = deflate (zs, Z_SYNC_FLUSH);
+    if (ret != Z_OK && ret != Z_BUF_ERROR)
+      goto failed;
+    len = cap - zs->avail_out;
+  } while (zs->avail_out == 0);
+
+  /* remove the empty stored block appended by Z_SYNC_FLUSH */
+  if (len >= 4 && memcmp (buf + len - 4, "\x00\x00\xff\xff", 4) == 0)
+    len -= 4;
+
+  /* the peer must see the same history as our deflater, so reset it
+   * if we are going to send the message uncompressed. */
+  if (len >= (size_t) sz)
+    goto failed;
+
+  if (dfl->server_no_ctx_takeover)
+    deflateReset (zs);
+
+  dfl->nr_deflated++;
+  dfl->sz_deflate_in += sz;
+  dfl->sz_deflate_out += len;
+  dfl->ns_deflate += ws_thread_cputime_ns () - t_start;
+
+  *zsz = (int) len;
+  return buf;
+
+failed:
+  deflateReset (zs);
+  free (buf);
+  dfl->ns_deflate += ws_thread_cputime_ns () - t_start;
+  return NULL;
+}
+
+/* Decompress the payload of a compressed message and replace it.
+ *
+ * On error, 1 is returned.
+ * On success, 0 is returned. */
+static int
+ws_inflate_message (WSClient * client, WSMessage * msg)
+{
+  static const unsigned char tail[4] = { 0x00, 0x00, 0xff, 0xff };
+  WSDeflate *dfl = client->deflate;
+  z_stream *zs = &dfl->inflater;
+  uint64_t t_start = ws_thread_cputime_ns ();
+  size_t len = 0, cap;
+  char *buf, *tmp;
+  int i, ret = Z_OK;
+
+  cap = (size_t) msg->payloadsz * 4 + 64;
+  if (cap > PCRDR_MAX_INMEM_PAYLOAD_SIZE)
+    cap = PCRDR_MAX_INMEM_PAYLOAD_SIZE;
+  if ((buf = malloc (cap)) == NULL)
+    return 1;
+
+  /* feed the payload followed by the tail stripped by the peer */
+  for (i = 0; i < 2 && ret != Z_STREAM_END; i++) {
+    zs->next_in = (i == 0) ? (Bytef *) msg->payload : (Bytef *) tail;
+    zs->avail_in = (i == 0) ? (uInt) msg->payloadsz : sizeof (tail);
+
+    do {
+      if (len == cap) {
+        /* refuse to inflate a message beyond the maximal payload size */
+        if (cap >= PCRDR_MAX_INMEM_PAYLOAD_SIZE)
+          goto failed;
+        cap *= 2;
+        if (cap > PCRDR_MAX_INMEM_PAYLOAD_SIZE)
+          cap = PCRDR_MAX_INMEM_PAYLOAD_SIZE;
+        if ((tmp = realloc (buf, cap)) == NULL)
+          goto failed;
+        buf = tmp;
+      }
+
+      zs->next_out = (Bytef *) buf + len;
+      zs->avail_out = cap - len;
+      ret = inflate (zs, Z_SYNC_FLUSH);
+      if (ret != Z_OK && ret != Z_BUF_ERROR && ret != Z_STREAM_END)
+        goto failed;
+      len = cap - zs->avail_out;
+    } while (zs->avail_out == 0 && ret != Z_STREAM_END);
+  }
+
+  if (ret == Z_STREAM_END || dfl->client_no_ctx_takeover)
+    inflateReset (zs);
+
+  /* always reserve a space for null character */
+  if ((tmp = realloc (buf, len + 1)) == NULL)
+    goto failed;
+  buf = tmp;
+  buf[len] = '\0';
+
+  dfl->nr_inflated++;
+  dfl->sz_inflate_in += msg->payloadsz;
+  dfl->sz_inflate_out += len;
+  dfl->ns_inflate += ws_thread_cputime_ns () - t_start;
+
+  free (msg->payload);
+  msg->payload = buf;
+  msg->payloadsz = (int) len;
+  update_upper_entity_stats (client->entity,
+          client->sockqueue ? client->sockqueue->qlen : 0, len);
+  return 0;
+
+failed:
+  free (buf);
+  dfl->ns_inflate += ws_thread_cputime_ns () - t_start;
+  return 1;
+}
+#endif /* HAVE(ZLIB) */
+
 /* Encode a websocket frame (header/message) and attempt to send it
  * through the client's socket.
  *
  * On success, 0 is returned. */
 static int
-ws_send_frame (WSServer * server, WSClient * client, WSOpcode opcode, const char *p, int sz)
+ws_send_frame_ex (WSServer * server, WSClient * client, WSOpcode opcode,
+        int rsv1, const char *p, int sz)
 {
   unsigned char buf[32] = { 0 };
   char *frm = NULL;
@@ -1265,7 +1821,7 @@ ws_send_frame (WSServer * server, WSClient * client, WSOpcode opcode, const char
     hsize += 8;
   }
 
-  buf[0] = 0x80 | ((uint8_t) opcode);
+  buf[0] = 0x80 | (rsv1 ? 0x40 : 0x00) | ((uint8_t) opcode);
   switch (payloadlen) {
   case WS_PAYLOAD_EXT16:
     buf[1] = WS_PAYLOAD_EXT16;
@@ -1291,6 +1847,39 @@ ws_send_frame (WSServer * server, WSClient * client, WSOpcode opcode, const char
   return 0;
 }
 
+/* Encode a websocket frame without any extension bits.
+ *
+ * On success, 0 is returned. */
+static int
+ws_send_frame (WSServer * server, WSClient * client, WSOpcode opcode, const char *p, int sz)
+{
+  return ws_send_frame_ex (server, client, opcode, 0, p, sz);
+}
+
+/* Encode a data frame, compressing the payload if permessage-deflate
+ * was negotiated and the message is large enough.
+ *
+ * On success, 0 is returned. */
+static int
+ws_send_data_frame (WSServer * server, WSClient * client, WSOpcode opcode,
+        const char *p, int sz)
+{
+#if HAVE(ZLIB)
+  if (client->deflate && sz >= server->config->deflate_min_size) {
+    char *zbuf;
+    int zsz = 0, ret;
+
+    if ((zbuf = ws_deflate_message (client, p, sz, &zsz)) != NULL) {
+      ret = ws_send_frame_ex (server, client, opcode, 1, zbuf, zsz);
+      free (zbuf);
+      return ret;
+    }
+  }
+#endif
+
+  return ws_send_frame_ex (server, client, opcode, 0, p, sz);
+}
+
 /* Send an error message to the given client.
  *
  * On success, the number of sent bytes is returned. */
@@ -1380,7 +1969,7 @@ ws_sha1_digest (const char *s, int len, unsigned char *digest)
 
 /* Set the parsed websocket handshake headers. */
 static void
-ws_set_handshake_headers (WSHeaders * headers)
+ws_set_handshake_headers (WSServer * server, WSClient * client, WSHeaders * headers)
 {
   size_t klen = strlen (headers->ws_key);
   size_t mlen = strlen (WS_MAGIC_STR);
@@ -1405,6 +1994,13 @@ ws_set_handshake_headers (WSHeaders * headers)
   if (!headers->connection)
     headers->upgrade = strdup ("Upgrade");
 
+#if HAVE(ZLIB)
+  ws_negotiate_deflate (server, client, headers);
+#else
+  (void)server;
+  (void)client;
+#endif
+
   free (s);
 }
 
@@ -1430,7 +2026,15 @@ ws_send_handshake_headers (WSServer * server, WSClient * client, WSHeaders * hea
 
   ws_append_str (&str, "Sec-WebSocket-Accept: ");
   ws_append_str (&str, headers->ws_accept);
-  ws_append_str (&str, CRLF CRLF);
+  ws_append_str (&str, CRLF);
+
+  if (headers->ws_ext_resp) {
+    ws_append_str (&str, "Sec-WebSocket-Extensions: ");
+    ws_append_str (&str, headers->ws_ext_resp);
+    ws_append_str (&str, CRLF);
+  }
+
+  ws_append_str (&str, CRLF);
 
   bytes = ws_respond (server, client, str, strlen (str));
   free (str);
@@ -1484,7 +2088,7 @@ ws_get_handshake (WSServer * server, WSClient * client)
     return ws_set_status (client, WS_CLOSE, bytes);
   }
 
-  ws_set_handshake_headers (client->headers);
+  ws_set_handshake_headers (server, client, client->headers);
 
   /* handshake response */
   ws_send_handshake_headers (server, client, client->headers);
@@ -1545,7 +2149,7 @@ ws_send_packet (WSServer *server, WSClient *client, WSOpcode opcode, const char
     switch (opcode) {
         case WS_OPCODE_TEXT:
         case WS_OPCODE_BIN:
-            return ws_send_frame (server, client, opcode, p, sz);
+            return ws_send_data_frame (server, client, opcode, p, sz);
 
         case WS_OPCODE_PING:
             return ws_send_frame (server, client, WS_OPCODE_PING, NULL, 0);
@@ -1581,7 +2185,7 @@ ws_send_packet_safe (WSServer *server, WSClient *client,
             break;
 
         case WS_OPCODE_BIN:
-            return ws_send_frame (server, client, WS_OPCODE_BIN, p, sz);
+            return ws_send_data_frame (server, client, WS_OPCODE_BIN, p, sz);
 
         case WS_OPCODE_PING:
             return ws_send_frame (server, client, WS_OPCODE_PING, NULL, 0);
@@ -1594,7 +2198,7 @@ ws_send_packet_safe (WSServer *server, WSClient *client,
             return -1;
     }
 
-    retv = ws_send_frame (server, client, opcode, buf, sz);
+    retv = ws_send_data_frame (server, client, opcode, buf, sz);
     if (buf) {
         free (buf);
     }
@@ -1656,7 +2260,18 @@ ws_set_front_header_fields (WSClient * client)
   (*frm)->fin = WS_FRM_FIN (*(buf));
   (*frm)->masking = WS_FRM_MASK (*(buf + 1));
   (*frm)->opcode = WS_FRM_OPCODE (*(buf));
-  (*frm)->res = WS_FRM_R1 (*(buf)) || WS_FRM_R2 (*(buf)) || WS_FRM_R3 (*(buf));
+  (*frm)->rsv1 = WS_FRM_R1 (*(buf));
+  (*frm)->res = WS_FRM_R2 (*(buf)) || WS_FRM_R3 (*(buf));
+
+  /* RSV1 is only allowed on the first frame of a compressed message */
+#if HAVE(ZLIB)
+  if ((*frm)->rsv1 && (client->deflate == NULL ||
+      ((*frm)->opcode != WS_OPCODE_TEXT && (*frm)->opcode != WS_OPCODE_BIN)))
+    (*frm)->res = 1;
+#else
+  if ((*frm)->rsv1)
+    (*frm)->res = 1;
+#endif
 
   /* should be masked and can't be using RESVd  bits */
   if (!(*frm)->masking || (*frm)->res)
@@ -1821,6 +2436,14 @@ ws_handle_text_bin (WSServer * server, WSClient * client)
   if (!(*frm)->fin)
     return;
 
+#if HAVE(ZLIB)
+  if ((*msg)->compressed && ws_inflate_message (client, *msg) != 0) {
+    ws_handle_err (server, client, WS_CLOSE_UNEXPECTED, WS_ERR | WS_CLOSE,
+            "Unable to inflate message");
+    return;
+  }
+#endif
+
   /* validate text data encoded as UTF-8 */
   if ((*msg)->opcode == WS_OPCODE_TEXT) {
     if (ws_validate_string ((*msg)->payload, (*msg)->payloadsz) != 0) {
@@ -1857,6 +2480,7 @@ ws_manage_payload_opcode (WSServer * server, WSClient * client)
   case WS_OPCODE_BIN:
     purc_log_info ("TEXT\n");
     client->message->opcode = (*frm)->opcode;
+    client->message->compressed = (*frm)->rsv1;
     clock_gettime (CLOCK_MONOTONIC, &client->ts);
     ws_handle_text_bin (server, client);
     break;
@@ -2114,7 +2738,9 @@ read_client_data (WSServer * server, WSClient * client)
   if ((!(client->headers) || (client->headers->reading))) {
 
       bytes = ws_get_handshake (server, client);
-      if (!(client->status & WS_CLOSE) && server->on_accepted) {
+      /* the request may come in several reads */
+      if (!(client->status & WS_CLOSE) && !client->headers->reading &&
+          server->on_accepted) {
           int ret_code;
           ret_code = server->on_accepted (server, (SockClient *)client);
           if (ret_code != PCRDR_SC_OK) {
@@ -2169,6 +2795,9 @@ ws_cleanup_client (WSServer * server, WSClient * client)
     SSL_free (client->ssl);
   client->ssl = NULL;
 #endif
+#if HAVE(ZLIB)
+  ws_free_deflate (client);
+#endif
 
   server->nr_clients--;
   purc_log_info ("Active: %d\n", server->nr_clients);
@@ -2185,15 +2814,21 @@ handle_ws_read_close (WSServer * server, WSClient * client)
   ws_cleanup_client (server, client);
 }
 
-/* Handle a new socket connection. */
+/* Handle a new socket connection.
+ *
+ * `*retv` is set to 0 if a pending connection was handled (accepted or
+ * refused), or -1 if there is no pending connection or accept() failed. */
 WSClient*
-ws_handle_accept (WSServer * server, int listener)
+ws_handle_accept (WSServer * server, int listener, int *retv)
 {
   WSClient *client;
 
+  *retv = 0;
   client = accept_client (listener/*, &server->colist*/);
-  if (client == NULL)
+  if (client == NULL) {
+    *retv = -1;
     return NULL;
+  }
 
   server->nr_clients++;
   if (server->nr_clients > MAX_CLIENTS_EACH) {
@@ -2221,8 +2856,13 @@ ws_handle_accept (WSServer * server, int listener)
 int
 ws_handle_reads (WSServer * server, WSClient * client)
 {
+  client->drained = 0;
+
 #if HAVE(LIBSSL)
-  if (handle_ssl_pending_rw (server, client) == 0)
+  int ret = handle_ssl_pending_rw (server, client);
+  if (ret < 0)
+    return -1;
+  if (ret == 0)
     return 1;
 #endif
 
@@ -2240,6 +2880,91 @@ ws_handle_reads (WSServer * server, WSClient * client)
   return 0;
 }
 
+#if HAVE(LIBSSL)
+/* Check if there is something to read from the client. */
+static int
+ws_has_pending_data (WSClient * client)
+{
+  char c;
+
+  if (SSL_pending (client->ssl) > 0)
+    return 1;
+
+  if (recv (client->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) >= 0)
+    return 1;
+
+  return errno != EAGAIN && errno != EWOULDBLOCK;
+}
+
+/* Apply the results of the TLS handshake steps done by the workers on
+ * the main thread.
+ *
+ * Only the clients queued before the call are handled, so that a client
+ * requeued here is not spun on in the same round.
+ * The number of the clients handled is returned. */
+int
+ws_handle_tls_handshakes (WSServer * server)
+{
+  WSClient *client;
+  int n = 0, nr_done;
+
+  if (server->tls_done == NULL)
+    return 0;
+
+  nr_done = g_async_queue_length (server->tls_done);
+  while (n < nr_done &&
+         (client = g_async_queue_try_pop (server->tls_done))) {
+    uint64_t t_start = ws_monotonic_ns ();
+    int i;
+
+    n++;
+    client->sslstatus &= ~WS_TLS_OFFLOADED;
+    if (client->ssl_step == WS_TLS_STEP_WANT_READ ||
+        client->ssl_step == WS_TLS_STEP_WANT_WRITE) {
+      /* the bytes arrived during the step raised no new event for an
+       * edge-triggered socket, so requeue the client if there are any;
+       * otherwise, the next read event requeues it. A full send buffer
+       * is rare during a handshake; just retry it on the next round. */
+      if ((client->ssl_step == WS_TLS_STEP_WANT_WRITE ||
+           ws_has_pending_data (client)) &&
+          ws_offload_accept_ssl (server, client))
+        client->ssl_step = WS_TLS_STEP_FAILED;
+    }
+
+    /* the client is watched for reading again unless it was requeued */
+    if (client->ssl_step != WS_TLS_STEP_FAILED &&
+        !(client->sslstatus & WS_TLS_OFFLOADED) && server->on_tls_offload)
+      server->on_tls_offload (server, (SockClient *)client, 0);
+
+    if (client->ssl_step == WS_TLS_STEP_FAILED) {
+      server->tls_stats.nr_failed++;
+      client->sslstatus &= ~WS_TLS_ACCEPTING;
+      ws_set_status (client, WS_ERR | WS_CLOSE, 1);
+      handle_ws_read_close (server, client);
+    }
+    else if (client->ssl_step == WS_TLS_STEP_DONE) {
+      client->sslstatus &= ~WS_TLS_ACCEPTING;
+      ws_tls_account (server, client);
+      purc_log_info ("SSL Accepted: %d %s (%s)\n", client->fd,
+                     client->remote_ip,
+                     SSL_session_reused (client->ssl) ? "resumed" : "full");
+
+      /* the data arrived during the handshake did not raise a new event
+       * for an edge-triggered socket */
+      for (i = 0; i < WS_TLS_READ_BUDGET; i++) {
+        if (ws_handle_reads (server, client) < 0 ||
+            (client->status & WS_CLOSE) || client->drained)
+          break;
+      }
+    }
+
+    server->tls_stats.main_ns += ws_monotonic_ns () - t_start;
+  }
+
+  return n;
+}
+#endif
+
 /* Handle a tcp write close connection. */
 static void
 handle_write_close (WSServer * server, WSClient * client)
@@ -2256,7 +2981,10 @@ int
 ws_handle_writes (WSServer * server, WSClient * client)
 {
 #if HAVE(LIBSSL)
-  if (handle_ssl_pending_rw (server, client) == 0)
+  int ret = handle_ssl_pending_rw (server, client);
+  if (ret < 0)
+    return -1;
+  if (ret == 0)
     return 1;
 #endif
 
@@ -2334,6 +3062,9 @@ ws_listen (WSServer* server)
 
   fcntl (listener, F_SETFD, FD_CLOEXEC);
 
+  /* the listener is drained in a loop, so it must not block */
+  set_nonblocking (listener);
+
   /* Options */
   if (setsockopt (listener, SOL_SOCKET, SO_REUSEADDR, &ov, sizeof (ov)) == -1) {
     purc_log_error ("Unable to set setsockopt: %s.", strerror (errno));
@@ -43,6 +43,11 @@
 #include <openssl/crypto.h>
 #include <openssl/err.h>
 #include <openssl/ssl.h>
+#include <glib.h>
+#endif
+
+#if HAVE(ZLIB)
+#include <zlib.h>
 #endif
 
 #if defined(__linux__) || defined(__CYGWIN__)
@@ -122,6 +127,12 @@
 #define WS_FRM_OPCODE(x)      ((x) & 0x0F)
 #define WS_FRM_PAYLOAD(x)     ((x) & 0x7F)
 
+/* parameters for the permessage-deflate extension (RFC 7692) */
+#define WS_DEFLATE_EXT_NAME   "permessage-deflate"
+#define WS_DEFLATE_MIN_WBITS  9
+#define WS_DEFLATE_MAX_WBITS  15
+#define WS_DEFLATE_MIN_SIZE   1024     /* do not compress small messages */
+
 #define WS_CLOSE_NORMAL       1000
 #define WS_CLOSE_GOING_AWAY   1001
 #define WS_CLOSE_PROTO_ERR    1002
@@ -141,8 +152,18 @@ typedef enum WSSTATUS
   WS_TLS_READING = (1 << 6),
   WS_TLS_WRITING = (1 << 7),
   WS_TLS_SHUTTING = (1 << 8),
+  WS_TLS_OFFLOADED = (1 << 9),
 } WSStatus;
 
+/* The result of a TLS handshake step done by a worker */
+typedef enum WSTLSSTEP
+{
+  WS_TLS_STEP_DONE = 0,
+  WS_TLS_STEP_WANT_READ,
+  WS_TLS_STEP_WANT_WRITE,
+  WS_TLS_STEP_FAILED,
+} WSTLSStep;
+
 typedef enum WSOPCODE
 {
   WS_OPCODE_CONTINUATION = 0x00,
@@ -179,9 +200,11 @@ typedef struct WSHeaders_
   char *ws_protocol;
   char *ws_key;
   char *ws_sock_ver;
+  char *ws_extensions;
 
   char *ws_accept;
   char *ws_resp;
+  char *ws_ext_resp;
 } WSHeaders;
 
 /* A WebSocket Message */
@@ -191,6 +214,7 @@ typedef struct WSFrame_
   WSOpcode opcode;              /* frame opcode */
   unsigned char fin;            /* frame fin flag */
   unsigned char mask[4];        /* mask key */
+  uint8_t rsv1;                 /* per-message compressed */
   uint8_t res;                  /* extensions */
   int payload_offset;           /* end of header/start of payload */
   int payloadlen;               /* payload length (for each frame) */
@@ -208,6 +232,7 @@ typedef struct WSMessage_
 {
   WSOpcode opcode;              /* frame opcode */
   int fragmented;               /* reading a fragmented frame */
+  int compressed;               /* compressed by permessage-deflate */
   int mask_offset;              /* for fragmented frames */
 
   char *payload;                /* payload message */
@@ -215,6 +240,30 @@ typedef struct WSMessage_
   int buflen;                   /* recv'd buf length so far (for each frame) */
 } WSMessage;
 
+#if HAVE(ZLIB)
+/* The negotiated permessage-deflate context of a client */
+typedef struct WSDeflate_
+{
+  z_stream deflater;            /* stream for outgoing messages */
+  z_stream inflater;            /* stream for incoming messages */
+
+  int server_wbits;             /* window bits used by the deflater */
+  int server_no_ctx_takeover;   /* reset the deflater after each message */
+  int client_no_ctx_takeover;   /* reset the inflater after each message */
+
+  /* statistics */
+  uint64_t nr_deflated;         /* number of compressed outgoing messages */
+  uint64_t sz_deflate_in;       /* bytes before compression */
+  uint64_t sz_deflate_out;      /* bytes after compression */
+  uint64_t ns_deflate;          /* CPU time spent on compression */
+
+  uint64_t nr_inflated;         /* number of compressed incoming messages */
+  uint64_t sz_inflate_in;       /* bytes before decompression */
+  uint64_t sz_inflate_out;      /* bytes after decompression */
+  uint64_t ns_inflate;          /* CPU time spent on decompression */
+} WSDeflate;
+#endif
+
 /* A WebSocket Client */
 typedef struct WSClient_
 {
@@ -231,6 +280,7 @@ typedef struct WSClient_
   WSFrame *frame;               /* frame headers */
   WSMessage *message;           /* message */
   WSStatus status;              /* connection status */
+  int drained;                  /* the last read found nothing to read */
 
   struct timeval start_proc;
   struct timeval end_proc;
@@ -238,9 +288,35 @@ typedef struct WSClient_
 #if HAVE(LIBSSL)
   SSL *ssl;
   WSStatus sslstatus;           /* ssl connection status */
+  uint64_t ssl_handshake_ns;    /* time spent on the handshake by workers */
+  WSTLSStep ssl_step;           /* the result of the last step on a worker */
+#endif
+
+#if HAVE(ZLIB)
+  WSDeflate *deflate;           /* permessage-deflate context */
 #endif
 } WSClient;
 
+#if HAVE(LIBSSL)
+/* The default number of the workers for TLS handshakes */
+#define WS_TLS_DEF_WORKERS      2
+
+/* The maximal reads for a client after its handshake was done by a worker */
+#define WS_TLS_READ_BUDGET      16
+
+/* The statistics of the TLS handshakes */
+typedef struct WSTLSStats_
+{
+  uint64_t nr_handshakes;       /* the handshakes completed */
+  uint64_t nr_resumed;          /* the sessions resumed by tickets or ids */
+  uint64_t nr_failed;           /* the handshakes failed */
+  uint64_t worker_ns;           /* time spent on the workers */
+  uint64_t main_ns;             /* time the main thread stalled for TLS */
+  uint64_t first_ns;            /* when the first handshake started */
+  uint64_t last_ns;             /* when the last handshake completed */
+} WSTLSStats;
+#endif
+
 struct SockClient_;
 
 /* A WebSocket Instance */
@@ -257,9 +333,21 @@ typedef struct WSServer_
   int (*on_pending) (void *server, struct SockClient_* client);
   int (*on_close) (void *server, struct SockClient_ * client);
   void (*on_error) (void *server, struct SockClient_* client, int err_code);
+#if HAVE(LIBSSL)
+  /* called when the handshake of a client is handed over to the workers
+   * (offloaded is 1) and when the client is back on the main thread */
+  void (*on_tls_offload) (void *server, struct SockClient_* client,
+          int offloaded);
+#endif
 
 #if HAVE(LIBSSL)
   SSL_CTX *ctx;
+
+  /* the workers for TLS handshakes; NULL to do handshakes in place */
+  GThreadPool *tls_pool;
+  /* the clients of which the handshakes were done by the workers */
+  GAsyncQueue *tls_done;
+  WSTLSStats tls_stats;
 #endif
 
   purcmc_server_config* config;
@@ -281,9 +369,12 @@ int ws_initialize_ssl_ctx (WSServer * server);
 int ws_listen (WSServer *server);
 void ws_stop (WSServer *server);
 
-WSClient* ws_handle_accept (WSServer * server, int listener);
+WSClient* ws_handle_accept (WSServer * server, int listener, int *retv);
 int ws_handle_reads (WSServer * server, WSClient * client);
 int ws_handle_writes (WSServer * server, WSClient * client);
+#if HAVE(LIBSSL)
+int ws_handle_tls_handshakes (WSServer * server);
+#endif
 int ws_remove_dangling_client (WSServer * server, WSClient *client);
 void ws_cleanup_client (WSServer * server, WSClient * client);
 
@@ -0,0 +1,503 @@
+/*
+** AssetCache.c -- The cache of the assets served by the renderer.
+**
+** Copyright (C) 2023 FMSoft (http://www.fmsoft.cn)
+**
+** This file is part of xGUI Pro, an advanced HVML renderer.
+**
+** xGUI Pro is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** xGUI Pro is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see http://www.gnu.org/licenses/.
+*/
+
+#include "config.h"
+
+#include "AssetCache.h"
+#include "MimeTypes.h"
+#include "utils/utils.h"
+
+#include <sys/stat.h>
+#include <string.h>
+
+/* the number of bytes to guess the content type */
+#define LEN_TO_GUESS        4096
+
+/* the maximum number of assets kept mapped */
+#define MAX_CACHED_ASSETS   256
+
+/* the signatures and sizes of the zip records we use */
+#define ZIP_SIG_LOCAL_HEADER        0x04034b50
+#define ZIP_SIG_CENTRAL_HEADER      0x02014b50
+#define ZIP_SIG_END_OF_CENTRAL_DIR  0x06054b50
+
+#define ZIP_LEN_LOCAL_HEADER        30
+#define ZIP_LEN_CENTRAL_HEADER      46
+#define ZIP_LEN_END_OF_CENTRAL_DIR  22
+#define ZIP_MAX_COMMENT             0xFFFF
+
+#define ZIP_METHOD_STORED           0
+#define ZIP_METHOD_DEFLATED         8
+
+#define ZIP_FLAG_ENCRYPTED          0x0001
+
+struct cached_asset {
+    GBytes *contents;
+    gchar *content_type;
+    off_t size;
+    struct timespec mtime;
+    ino_t ino;
+    guint64 last_used;
+};
+
+struct archive_entry {
+    guint32 offset;         /* the offset of the local header */
+    guint32 compressed_size;
+    guint32 size;
+    guint16 method;
+    gchar *content_type;
+    gboolean type_guessed;
+};
+
+struct asset_archive {
+    GBytes *contents;
+    GHashTable *entries;    /* member name -> struct archive_entry;
+                               NULL if there is no usable archive */
+    gboolean exists;        /* FALSE if the path could not be stat'ed */
+    off_t size;
+    struct timespec mtime;
+    ino_t ino;
+};
+
+/* the assets may be opened from the threads loading them */
+G_LOCK_DEFINE_STATIC(asset_cache);
+
+static GHashTable *assets;
+static guint64 nr_lookups;
+
+/* archive path -> struct asset_archive */
+static GHashTable *archives;
+
+static void free_cached_asset(gpointer data)
+{
+    struct cached_asset *asset = data;
+    g_bytes_unref(asset->contents);
+    g_free(asset->content_type);
+    g_free(asset);
+}
+
+static void evict_least_recently_used(void)
+{
+    GHashTableIter iter;
+    gpointer key, value;
+    gpointer victim = NULL;
+    guint64 oldest = G_MAXUINT64;
+
+    g_hash_table_iter_init(&iter, assets);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        struct cached_asset *asset = value;
+        if (asset->last_used < oldest) {
+            oldest = asset->last_used;
+            victim = key;
+        }
+    }
+
+    if (victim)
+        g_hash_table_remove(assets, victim);
+}
+
+static struct cached_asset *map_asset(const char *path, const struct stat *st)
+{
+    GError *error = NULL;
+    GMappedFile *mapped = g_mapped_file_new(path, FALSE, &error);
+    if (mapped == NULL) {
+        LOG_WARN("Failed to map asset %s: %s\n", path, error->message);
+        g_error_free(error);
+        return NULL;
+    }
+
+    struct cached_asset *asset = g_new0(struct cached_asset, 1);
+    asset->contents = g_mapped_file_get_bytes(mapped);
+    g_mapped_file_unref(mapped);
+
+    gsize length;
+    const guchar *data = g_bytes_get_data(asset->contents, &length);
+
+    asset->content_type = guess_content_type(path, data,
+            MIN(length, LEN_TO_GUESS));
+
+    asset->size = st->st_size;
+    asset->mtime = st->st_mtim;
+    asset->ino = st->st_ino;
+    return asset;
+}
+
+static inline guint16 get_le16(const guchar *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static inline guint32 get_le32(const guchar *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((guint32)p[3] << 24);
+}
+
+static void free_archive_entry(gpointer data)
+{
+    struct archive_entry *entry = data;
+    g_free(entry->content_type);
+    g_free(entry);
+}
+
+static void free_asset_archive(gpointer data)
+{
+    struct asset_archive *archive = data;
+    if (archive->entries)
+        g_hash_table_destroy(archive->entries);
+    if (archive->contents)
+        g_bytes_unref(archive->contents);
+    g_free(archive);
+}
+
+static const guchar *find_end_of_central_dir(const guchar *data, gsize length)
+{
+    if (length < ZIP_LEN_END_OF_CENTRAL_DIR)
+        return NULL;
+
+    /* the record is followed by a comment of variable length */
+    gsize lowest = 0;
+    if (length > ZIP_LEN_END_OF_CENTRAL_DIR + ZIP_MAX_COMMENT)
+        lowest = length - ZIP_LEN_END_OF_CENTRAL_DIR - ZIP_MAX_COMMENT;
+
+    gsize pos = length - ZIP_LEN_END_OF_CENTRAL_DIR;
+    while (1) {
+        if (get_le32(data + pos) == ZIP_SIG_END_OF_CENTRAL_DIR)
+            return data + pos;
+        if (pos == lowest)
+            break;
+        pos--;
+    }
+
+    return NULL;
+}
+
+/* index the central directory once; the members are never extracted */
+static GHashTable *index_archive(const guchar *data, gsize length)
+{
+    const guchar *end = find_end_of_central_dir(data, length);
+    if (end == NULL)
+        return NULL;
+
+    guint nr_entries = get_le16(end + 10);
+    guint32 dir_size = get_le32(end + 12);
+    guint32 dir_offset = get_le32(end + 16);
+    if ((gsize)dir_offset + dir_size > length)
+        return NULL;
+
+    GHashTable *entries = g_hash_table_new_full(g_str_hash, g_str_equal,
+            g_free, free_archive_entry);
+
+    const guchar *p = data + dir_offset;
+    const guchar *dir_end = p + dir_size;
+    for (guint i = 0; i < nr_entries; i++) {
+        if (p + ZIP_LEN_CENTRAL_HEADER > dir_end ||
+                get_le32(p) != ZIP_SIG_CENTRAL_HEADER)
+            goto failed;
+
+        guint16 flags = get_le16(p + 8);
+        guint16 method = get_le16(p + 10);
+        guint16 name_len = get_le16(p + 28);
+        gsize rec_len = ZIP_LEN_CENTRAL_HEADER + name_len +
+            get_le16(p + 30) + get_le16(p + 32);
+        if (p + rec_len > dir_end)
+            goto failed;
+
+        const char *name = (const char *)p + ZIP_LEN_CENTRAL_HEADER;
+        if (name_len > 0 && name[name_len - 1] != '/' &&
+                !(flags & ZIP_FLAG_ENCRYPTED) &&
+                (method == ZIP_METHOD_STORED ||
+                 method == ZIP_METHOD_DEFLATED)) {
+            struct archive_entry *entry = g_new0(struct archive_entry, 1);
+            entry->method = method;
+            entry->compressed_size = get_le32(p + 20);
+            entry->size = get_le32(p + 24);
+            entry->offset = get_le32(p + 42);
+            g_hash_table_insert(entries, g_strndup(name, name_len), entry);
+        }
+
+        p += rec_len;
+    }
+
+    return entries;
+
+failed:
+    g_hash_table_destroy(entries);
+    return NULL;
+}
+
+static struct asset_archive *open_archive(const char *path,
+        const struct stat *st)
+{
+    GMappedFile *mapped = g_mapped_file_new(path, FALSE, NULL);
+    if (mapped == NULL)
+        return NULL;
+
+    struct asset_archive *archive = g_new0(struct asset_archive, 1);
+    archive->contents = g_mapped_file_get_bytes(mapped);
+    g_mapped_file_unref(mapped);
+
+    gsize length;
+    const guchar *data = g_bytes_get_data(archive->contents, &length);
+    archive->entries = index_archive(data, length);
+    if (archive->entries == NULL) {
+        LOG_WARN("Bad or unsupported asset archive: %s\n", path);
+        g_bytes_unref(archive->contents);
+        g_free(archive);
+        return NULL;
+    }
+
+    archive->exists = TRUE;
+    archive->size = st->st_size;
+    archive->mtime = st->st_mtim;
+    archive->ino = st->st_ino;
+    LOG_INFO("Indexed %u assets in archive %s\n",
+            g_hash_table_size(archive->entries), path);
+    return archive;
+}
+
+/* check whether the path is still the file (or the miss) that was cached */
+static gboolean archive_unchanged(const struct asset_archive *archive,
+        int stat_ret, const struct stat *st)
+{
+    if (stat_ret != 0)
+        return !archive->exists;
+
+    return archive->exists && archive->size == st->st_size &&
+        archive->ino == st->st_ino &&
+        archive->mtime.tv_sec == st->st_mtim.tv_sec &&
+        archive->mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+static struct asset_archive *get_archive(const char *path)
+{
+    struct asset_archive *archive;
+    struct stat st;
+    int ret = stat(path, &st);
+
+    archive = g_hash_table_lookup(archives, path);
+    if (archive) {
+        if (archive_unchanged(archive, ret, &st))
+            return archive->entries ? archive : NULL;
+
+        LOG_DEBUG("Asset archive changed: %s\n", path);
+        archive = NULL;
+    }
+
+    if (ret == 0 && S_ISREG(st.st_mode))
+        archive = open_archive(path, &st);
+
+    if (archive == NULL) {
+        /* remember the missing or bad archive along with its stat result,
+           so that it is tried again once the path changes */
+        archive = g_new0(struct asset_archive, 1);
+        if (ret == 0) {
+            archive->exists = TRUE;
+            archive->size = st.st_size;
+            archive->mtime = st.st_mtim;
+            archive->ino = st.st_ino;
+        }
+    }
+
+    g_hash_table_replace(archives, g_strdup(path), archive);
+    return archive->entries ? archive : NULL;
+}
+
+static GInputStream *open_archive_entry(struct asset_archive *archive,
+        const char *name, struct archive_entry *entry)
+{
+    gsize length;
+    const guchar *data = g_bytes_get_data(archive->contents, &length);
+
+    if ((gsize)entry->offset + ZIP_LEN_LOCAL_HEADER > length ||
+            get_le32(data + entry->offset) != ZIP_SIG_LOCAL_HEADER)
+        return NULL;
+
+    /* the extra field in the local header may differ from the central one */
+    const guchar *header = data + entry->offset;
+    gsize start = entry->offset + ZIP_LEN_LOCAL_HEADER +
+        get_le16(header + 26) + get_le16(header + 28);
+    if (start + entry->compressed_size > length)
+        return NULL;
+
+    GBytes *bytes = g_bytes_new_from_bytes(archive->contents,
+            start, entry->compressed_size);
+
+    if (!entry->type_guessed) {
+        if (entry->method == ZIP_METHOD_STORED) {
+            entry->content_type = guess_content_type(name, data + start,
+                    MIN(entry->size, LEN_TO_GUESS));
+        }
+        else {
+            entry->content_type = guess_content_type(name, NULL, 0);
+        }
+        entry->type_guessed = TRUE;
+    }
+
+    GInputStream *stream = g_memory_input_stream_new_from_bytes(bytes);
+    g_bytes_unref(bytes);
+
+    if (entry->method == ZIP_METHOD_DEFLATED) {
+        /* inflate while WebKit reads the stream */
+        GZlibDecompressor *decompressor =
+            g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_RAW);
+        GInputStream *inflated = g_converter_input_stream_new(stream,
+                G_CONVERTER(decompressor));
+        g_object_unref(decompressor);
+        g_object_unref(stream);
+        stream = inflated;
+    }
+
+    return stream;
+}
+
+/*
+ * Try the archives which may hold the file: for `a/b/c.css`, the member
+ * `a/b/c.css` in `a.zip`, then the member `b/c.css` in `a/b.zip`.
+ */
+static GInputStream *open_archived_asset(const char *dir, const char *file,
+        struct asset_meta *meta)
+{
+    if (archives == NULL) {
+        archives = g_hash_table_new_full(g_str_hash, g_str_equal,
+                g_free, free_asset_archive);
+    }
+
+    const char *member = file;
+    const char *slash;
+    while ((slash = strchr(member, '/'))) {
+        gchar *path = g_strdup_printf("%s/%.*s.zip", dir,
+                (int)(slash - file), file);
+        struct asset_archive *archive = get_archive(path);
+        g_free(path);
+
+        if (archive) {
+            struct archive_entry *entry =
+                g_hash_table_lookup(archive->entries, member);
+            if (entry) {
+                GInputStream *stream = open_archive_entry(archive,
+                        member, entry);
+                if (stream) {
+                    meta->length = entry->size;
+                    meta->content_type = g_strdup(entry->content_type);
+                    meta->etag = g_strdup_printf("\"%lx-%lx-%x-%x\"",
+                            (unsigned long)archive->ino,
+                            (unsigned long)archive->mtime.tv_sec,
+                            entry->offset, entry->size);
+                    meta->last_modified = archive->mtime.tv_sec;
+                }
+                return stream;
+            }
+        }
+
+        member = slash + 1;
+        while (*member == '/')
+            member++;
+    }
+
+    return NULL;
+}
+
+static GInputStream *open_asset(const char *env, const char *prefix,
+        const char *file, struct asset_meta *meta)
+{
+    const char *dir = env ? g_getenv(env) : NULL;
+    if (dir == NULL) {
+        dir = prefix ? prefix : ".";
+    }
+
+    gchar *path = g_strdup_printf("%s/%s", dir, file);
+
+    struct stat st;
+    if (stat(path, &st) || !S_ISREG(st.st_mode)) {
+        g_free(path);
+        return open_archived_asset(dir, file, meta);
+    }
+
+    if (assets == NULL) {
+        assets = g_hash_table_new_full(g_str_hash, g_str_equal,
+                g_free, free_cached_asset);
+    }
+
+    struct cached_asset *asset = g_hash_table_lookup(assets, path);
+    if (asset && (asset->size != st.st_size || asset->ino != st.st_ino ||
+            asset->mtime.tv_sec != st.st_mtim.tv_sec ||
+            asset->mtime.tv_nsec != st.st_mtim.tv_nsec)) {
+        LOG_DEBUG("Asset changed: %s\n", path);
+        g_hash_table_remove(assets, path);
+        asset = NULL;
+    }
+
+    if (asset == NULL) {
+        asset = map_asset(path, &st);
+        if (asset == NULL) {
+            g_free(path);
+            return NULL;
+        }
+
+        if (g_hash_table_size(assets) >= MAX_CACHED_ASSETS)
+            evict_least_recently_used();
+        g_hash_table_insert(assets, path, asset);
+    }
+    else {
+        g_free(path);
+    }
+
+    asset->last_used = ++nr_lookups;
+    meta->length = g_bytes_get_size(asset->contents);
+    meta->content_type = g_strdup(asset->content_type);
+    meta->etag = g_strdup_printf("\"%lx-%lx-%lx.%lx\"",
+            (unsigned long)asset->ino, (unsigned long)asset->size,
+            (unsigned long)asset->mtime.tv_sec,
+            (unsigned long)asset->mtime.tv_nsec);
+    meta->last_modified = asset->mtime.tv_sec;
+    return g_memory_input_stream_new_from_bytes(asset->contents);
+}
+
+GInputStream *asset_cache_open(const char *env, const char *prefix,
+        const char *file, struct asset_meta *meta)
+{
+    G_LOCK(asset_cache);
+    GInputStream *stream = open_asset(env, prefix, file, meta);
+    G_UNLOCK(asset_cache);
+    return stream;
+}
+
+void asset_cache_cleanup(void)
+{
+    G_LOCK(asset_cache);
+    if (assets) {
+        g_hash_table_destroy(assets);
+        assets = NULL;
+    }
+
+    if (archives) {
+        g_hash_table_destroy(archives);
+        archives = NULL;
+    }
+    G_UNLOCK(asset_cache);
+}
+
+void asset_meta_clear(struct asset_meta *meta)
+{
+    g_free(meta->content_type);
+    meta->content_type = NULL;
+    g_free(meta->etag);
+    meta->etag = NULL;
+}
@@ -0,0 +1,67 @@
+/*
+** AssetCache.h -- The cache of the assets served by the renderer.
+**
+** Copyright (C) 2023 FMSoft (http://www.fmsoft.cn)
+**
+** This file is part of xGUI Pro, an advanced HVML renderer.
+**
+** xGUI Pro is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** xGUI Pro is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef AssetCache_h
+#define AssetCache_h
+
+#include <gio/gio.h>
+
+struct asset_meta {
+    gsize length;
+    gchar *content_type;    /* NULL if uncertain */
+    gchar *etag;            /* a quoted entity tag */
+    time_t last_modified;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Opens an asset through the process-wide cache. The file is located in
+ * the same way as open_and_load_asset(). It is mapped into memory once and
+ * its content type is guessed once; it is mapped again when its size or
+ * modification time changes.
+ *
+ * If the file does not exist, it is looked up in a zip archive named after
+ * one of its parent directories, e.g. `assets/bootstrap-5.3.1-dist.zip` for
+ * `assets/bootstrap-5.3.1-dist/css/bootstrap.min.css`. The archive is mapped
+ * and its central directory indexed once; stored members are served from
+ * the mapping directly and deflated ones are inflated while being read.
+ *
+ * Returns a stream of the contents, or NULL if the asset cannot be found.
+ * On success, `meta` holds the length of the contents, the content type,
+ * and the validators of the asset; free them with asset_meta_clear().
+ * It is safe to call this function from any thread.
+ */
+GInputStream *asset_cache_open(const char *env, const char *prefix,
+        const char *file, struct asset_meta *meta);
+
+/* Frees the strings in an asset_meta structure. */
+void asset_meta_clear(struct asset_meta *meta);
+
+/* Releases all cached assets. */
+void asset_cache_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* AssetCache_h */
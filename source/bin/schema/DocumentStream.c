@@ -0,0 +1,218 @@
+/*
+** DocumentStream.c -- The streams feeding documents written in chunks.
+**
+** Copyright (C) 2023 FMSoft (http://www.fmsoft.cn)
+**
+** This file is part of xGUI Pro, an advanced HVML renderer.
+**
+** xGUI Pro is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** xGUI Pro is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see http://www.gnu.org/licenses/.
+*/
+
+#include "config.h"
+
+#include "DocumentStream.h"
+#include "utils/utils.h"
+
+#include <glib-unix.h>
+#include <gio/gunixinputstream.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+struct doc_stream {
+    /* the write end of the pipe; -1 if closed or broken */
+    int fd;
+    GInputStream *input;
+    bool taken;
+
+    /* the chunks not written yet (GBytes) */
+    GQueue chunks;
+    gsize offset;   /* the bytes written of the head chunk */
+
+    guint watch;
+    bool ended;
+    /* the reader is gone, or the stream is abandoned */
+    bool failed;
+};
+
+struct doc_stream *doc_stream_new(void)
+{
+    GError *error = NULL;
+    int fds[2];
+
+    if (!g_unix_open_pipe(fds, FD_CLOEXEC, &error)) {
+        LOG_ERROR("Failed to open a pipe: %s\n", error->message);
+        g_error_free(error);
+        return NULL;
+    }
+
+    if (!g_unix_set_fd_nonblocking(fds[1], TRUE, &error)) {
+        LOG_ERROR("Failed to make a pipe nonblocking: %s\n", error->message);
+        g_error_free(error);
+        close(fds[0]);
+        close(fds[1]);
+        return NULL;
+    }
+
+    struct doc_stream *ds = g_new0(struct doc_stream, 1);
+    ds->fd = fds[1];
+    ds->input = g_unix_input_stream_new(fds[0], TRUE);
+    g_queue_init(&ds->chunks);
+    return ds;
+}
+
+static void drop_chunks(struct doc_stream *ds)
+{
+    GBytes *bytes;
+    while ((bytes = g_queue_pop_head(&ds->chunks)))
+        g_bytes_unref(bytes);
+    ds->offset = 0;
+}
+
+static void close_pipe(struct doc_stream *ds)
+{
+    if (ds->watch) {
+        g_source_remove(ds->watch);
+        ds->watch = 0;
+    }
+
+    if (ds->fd >= 0) {
+        close(ds->fd);
+        ds->fd = -1;
+    }
+}
+
+static gboolean on_pipe_writable(gint fd, GIOCondition condition,
+        gpointer user_data);
+
+/* Writes the queued chunks until the pipe is full. The pipe is closed
+   once all chunks of an ended document are written. */
+static void flush_chunks(struct doc_stream *ds)
+{
+    GBytes *bytes;
+    while (ds->fd >= 0 && (bytes = g_queue_peek_head(&ds->chunks))) {
+        gsize len;
+        const char *data = g_bytes_get_data(bytes, &len);
+        ssize_t n = write(ds->fd, data + ds->offset, len - ds->offset);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (ds->watch == 0) {
+                    ds->watch = g_unix_fd_add(ds->fd, G_IO_OUT,
+                            on_pipe_writable, ds);
+                }
+                return;
+            }
+
+            /* the reader is gone */
+            LOG_WARN("Failed to write to the document stream: %s\n",
+                    strerror(errno));
+            close_pipe(ds);
+            drop_chunks(ds);
+            ds->failed = true;
+            break;
+        }
+
+        ds->offset += n;
+        if (ds->offset == len) {
+            g_bytes_unref(g_queue_pop_head(&ds->chunks));
+            ds->offset = 0;
+        }
+    }
+
+    if (ds->ended && g_queue_is_empty(&ds->chunks))
+        close_pipe(ds);
+}
+
+static gboolean on_pipe_writable(gint fd, GIOCondition condition,
+        gpointer user_data)
+{
+    struct doc_stream *ds = user_data;
+    (void)fd;
+    (void)condition;
+
+    ds->watch = 0;
+    flush_chunks(ds);
+    return G_SOURCE_REMOVE;
+}
+
+GInputStream *doc_stream_take_input(struct doc_stream *ds)
+{
+    GInputStream *input = ds->input;
+    if (input) {
+        ds->input = NULL;
+        ds->taken = true;
+        flush_chunks(ds);
+    }
+    return input;
+}
+
+bool doc_stream_write(struct doc_stream *ds, const char *data, size_t len)
+{
+    if (ds->fd < 0 || ds->ended)
+        return false;
+
+    if (len > 0) {
+        g_queue_push_tail(&ds->chunks, g_bytes_new(data, len));
+        if (ds->taken && ds->watch == 0)
+            flush_chunks(ds);
+    }
+
+    return true;
+}
+
+void doc_stream_end(struct doc_stream *ds)
+{
+    ds->ended = true;
+    if (ds->taken && ds->watch == 0)
+        flush_chunks(ds);
+}
+
+GBytes *doc_stream_abandon(struct doc_stream *ds, bool *ended)
+{
+    if (ds->taken)
+        return NULL;
+
+    GByteArray *doc = g_byte_array_new();
+    GBytes *bytes;
+    while ((bytes = g_queue_pop_head(&ds->chunks))) {
+        gsize len;
+        const guint8 *data = g_bytes_get_data(bytes, &len);
+        g_byte_array_append(doc, data, len);
+        g_bytes_unref(bytes);
+    }
+
+    close_pipe(ds);
+    g_clear_object(&ds->input);
+    ds->taken = true;
+    ds->failed = true;
+
+    *ended = ds->ended;
+    return g_byte_array_free_to_bytes(doc);
+}
+
+bool doc_stream_is_done(struct doc_stream *ds)
+{
+    return ds->taken && ds->ended && !ds->failed && ds->fd < 0;
+}
+
+void doc_stream_delete(struct doc_stream *ds)
+{
+    close_pipe(ds);
+    drop_chunks(ds);
+    if (ds->input)
+        g_object_unref(ds->input);
+    g_free(ds);
+}
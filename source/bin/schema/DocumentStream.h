@@ -0,0 +1,77 @@
+/*
+** DocumentStream.h -- The streams feeding documents written in chunks.
+**
+** Copyright (C) 2023 FMSoft (http://www.fmsoft.cn)
+**
+** This file is part of xGUI Pro, an advanced HVML renderer.
+**
+** xGUI Pro is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** xGUI Pro is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef DocumentStream_h
+#define DocumentStream_h
+
+#include <gio/gio.h>
+#include <stdbool.h>
+
+/* the key of the document stream attached to a web view */
+#define DOC_STREAM_KEY      "purcmc-doc-stream"
+/* the key of the URI from which the web view loads the stream */
+#define DOC_STREAM_URI_KEY  "purcmc-stream-uri"
+
+struct doc_stream;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Creates a stream of a document to be written in chunks. */
+struct doc_stream *doc_stream_new(void);
+
+/*
+ * Takes the input stream from which WebKit reads the document, and
+ * starts to write the chunks to it. Returns NULL if it has been taken.
+ */
+GInputStream *doc_stream_take_input(struct doc_stream *ds);
+
+/*
+ * Appends a chunk of the document. The chunk is copied and written to
+ * the input stream as fast as the reader consumes it, without blocking.
+ * Returns false if the stream is ended, abandoned, or broken.
+ */
+bool doc_stream_write(struct doc_stream *ds, const char *data, size_t len);
+
+/*
+ * Ends the document. The reader gets the end of the stream once all
+ * chunks are consumed.
+ */
+void doc_stream_end(struct doc_stream *ds);
+
+/*
+ * Abandons a stream whose input has not been taken, and returns the
+ * chunks appended so far as one document; `ended` tells whether the
+ * document has been ended. Returns NULL if the input has been taken.
+ */
+GBytes *doc_stream_abandon(struct doc_stream *ds, bool *ended);
+
+/* Returns true if the whole document has been written to the reader. */
+bool doc_stream_is_done(struct doc_stream *ds);
+
+/* Deletes the stream at once, dropping the chunks not consumed. */
+void doc_stream_delete(struct doc_stream *ds);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* DocumentStream_h */
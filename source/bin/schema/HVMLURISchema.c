@@ -24,6 +24,9 @@
 
 #include "xguipro-features.h"
 #include "HVMLURISchema.h"
+#include "AssetCache.h"
+#include "MimeTypes.h"
+#include "DocumentStream.h"
 #include "BuildRevision.h"
 //#include "LayouterWidgets.h"
 
@@ -38,6 +41,7 @@
 #include <gio/gunixinputstream.h>
 
 #include <assert.h>
+#include <sys/stat.h>
 
 #if PLATFORM(MINIGUI)
 #include "minigui/PurcmcCallbacks.h"
@@ -63,6 +67,13 @@
 
 #define REDIRECT_LOCAL_FILE         0
 
+/* the maximum number of local assets loaded at the same time for a session */
+#define MAX_ASSET_LOADS_PER_SESSION 4
+
+/* the cache policies of the assets which can be revalidated */
+#define BUILTIN_ASSET_CACHE_CONTROL "max-age=86400"
+#define APP_ASSET_CACHE_CONTROL     "no-cache"
+
 struct hvml_broken_down_uri {
     const char *uri;
     const char *host;
@@ -485,103 +496,352 @@ void do_redirect(WebKitURISchemeRequest *request, purcmc_endpoint *endpoint,
 
 }
 
-void load_local_assets(WebKitURISchemeRequest *request,
-        purcmc_endpoint *endpoint, struct hvml_broken_down_uri *uri_st)
+struct asset_load {
+    WebKitURISchemeRequest *request;
+    purcmc_session *sess;
+
+    gchar *env;
+    gchar *prefix;
+    gchar *page;
+    unsigned flags;
+    bool builtin;
+    gchar *if_none_match;
+
+    /* the results from the loading thread */
+    GInputStream *stream;
+    struct asset_meta meta;
+    bool not_modified;
+    GError *error;
+};
+
+struct session_asset_loads {
+    unsigned nr_running;
+    GQueue pending;
+};
+
+/* purcmc_session * -> struct session_asset_loads */
+static GHashTable *asset_loads;
+
+static void free_asset_load(gpointer data)
 {
-    (void) endpoint;
-    GError *error = NULL;
-    int fd = -1;
-    ssize_t max_to_load = 1024 * 4;
-    gchar *contents = NULL;
-    gchar *content_type = NULL;
-    gsize content_length = 0;
+    struct asset_load *load = data;
+
+    g_object_unref(load->request);
+    g_free(load->env);
+    g_free(load->prefix);
+    g_free(load->page);
+    g_free(load->if_none_match);
+    if (load->stream)
+        g_object_unref(load->stream);
+    asset_meta_clear(&load->meta);
+    if (load->error)
+        g_error_free(load->error);
+    g_free(load);
+}
 
-    char prefix[PURC_LEN_APP_NAME + PURC_LEN_RUNNER_NAME + 32];
+static bool etag_matches(const char *if_none_match, const char *etag)
+{
+    return if_none_match && etag && (strcmp(if_none_match, "*") == 0 ||
+            strstr(if_none_match, etag) != NULL);
+}
 
-    if (strcmp(uri_st->app, PCRDR_APP_SYSTEM) == 0) {
-        if (strcmp(uri_st->runner, PCRDR_RUNNER_FILESYSTEM) == 0) {
-            /* try to load asset from the system filesystem */
-            strcpy(prefix, "/");
+/* called in a thread of the GIO pool; never touches WebKit objects */
+static void load_asset_in_thread(GTask *task, gpointer source_object,
+        gpointer task_data, GCancellable *cancellable)
+{
+    struct asset_load *load = task_data;
+    (void)source_object;
+    (void)cancellable;
+
+    if (load->builtin) {
+        /* the built-in assets are shared by all pages; serve them from
+           the mapped files in the cache without copying */
+        load->stream = asset_cache_open(load->env, load->prefix, load->page,
+                &load->meta);
+        if (load->stream == NULL) {
+            load->error = g_error_new(XGUI_PRO_ERROR,
+                    XGUI_PRO_ERROR_INVALID_HVML_URI,
+                    "Can not load contents from asset file (%s)", load->page);
         }
-        else {
-            /* TODO */
-            strcpy(prefix, "/");
+        else if (etag_matches(load->if_none_match, load->meta.etag)) {
+            g_object_unref(load->stream);
+            load->stream = NULL;
+            load->not_modified = true;
         }
-    }
-    else {
-        snprintf(prefix, sizeof(prefix), "/app/%s/exported", uri_st->real_app);
+        goto done;
     }
 
-    LOG_WARN("local res: uri=%s|prefix=%s|page=%s\n", uri_st->uri, prefix, uri_st->page);
+    gchar *path = g_build_filename(load->prefix, load->page, NULL);
+    if (!(load->flags & ASSET_FLAG_ONCE)) {
+        /* revalidate with the status of the file before reading it */
+        struct stat st;
+        if (stat(path, &st) == 0) {
+            load->meta.etag = g_strdup_printf("\"%lx-%lx-%lx.%lx\"",
+                    (unsigned long)st.st_ino, (unsigned long)st.st_size,
+                    (unsigned long)st.st_mtim.tv_sec,
+                    (unsigned long)st.st_mtim.tv_nsec);
+            load->meta.last_modified = st.st_mtim.tv_sec;
+        }
 
-    unsigned asset_flags = 0;
-    char *once_val = NULL;
-    if (purc_hvml_uri_get_query_value_alloc(uri_st->uri,
-                "once", &once_val) && strcmp(once_val, "yes") == 0) {
-        asset_flags |= ASSET_FLAG_ONCE;
+        if (etag_matches(load->if_none_match, load->meta.etag)) {
+            load->not_modified = true;
+            g_free(path);
+            goto done;
+        }
     }
-    if (once_val)
-        free(once_val);
 
-    if (asset_flags & ASSET_FLAG_ONCE) {
+    int fd = -1;
+    ssize_t max_to_load = 1024 * 4;
+    gchar *contents;
+    if (load->flags & ASSET_FLAG_ONCE) {
         /* If having ASSET_FLAG_ONCE load whole contents, and remove
            the asset file. */
-        contents = load_asset_content(NULL, prefix, uri_st->page, &content_length,
-                asset_flags);
-        max_to_load = content_length;
+        contents = load_asset_content(load->env, load->prefix, load->page,
+                &load->meta.length, load->flags);
+        max_to_load = load->meta.length;
     }
     else {
-        contents = open_and_load_asset(NULL, prefix, uri_st->page, &max_to_load,
-                &fd, &content_length);
+        contents = open_and_load_asset(load->env, load->prefix, load->page,
+                &max_to_load, &fd, &load->meta.length);
     }
 
     if (contents == NULL) {
-        error = g_error_new(XGUI_PRO_ERROR,
+        load->error = g_error_new(XGUI_PRO_ERROR,
                 XGUI_PRO_ERROR_INVALID_HVML_URI,
                 "Can not load contents from file system (%s/%s)",
-                prefix, uri_st->page);
-        webkit_uri_scheme_request_finish_error(request, error);
+                load->prefix, load->page);
+        g_free(path);
         goto done;
     }
 
-    gboolean result_uncertain;
-    content_type = g_content_type_guess(uri_st->page,
-            (const guchar *)contents, max_to_load, &result_uncertain);
+    load->meta.content_type = guess_content_type(path,
+            (const guchar *)contents, max_to_load);
+    g_free(path);
 
-    LOG_DEBUG("content type of URI (%s): %s (%s)\n",
-            uri_st->uri, content_type,
-            result_uncertain ? "uncertain" : "certain");
-
-    if (result_uncertain) {
-        if (content_type)
-            free(content_type);
-        content_type = NULL;
-    }
-
-    GInputStream *stream = NULL;
-    if (content_length > max_to_load && fd >= 0) {
+    if (load->meta.length > max_to_load && fd >= 0) {
         free(contents);
-        stream = g_unix_input_stream_new(fd, TRUE);
-        LOG_DEBUG("make a unix input stream for URI: %s (%s)\n",
-                uri_st->uri, content_type);
+        load->stream = g_unix_input_stream_new(fd, TRUE);
     }
     else {
         if (fd >= 0)
             close(fd);
 
-        stream = g_memory_input_stream_new_from_data(contents, content_length,
-                (contents != cover_page && contents != blank_page) ? g_free : NULL);
-        LOG_DEBUG("make a memory input stream for URI: %s (%s)\n",
-                uri_st->uri, content_type);
+        load->stream = g_memory_input_stream_new_from_data(contents,
+                load->meta.length, g_free);
     }
 
-    webkit_uri_scheme_request_finish(request, stream, content_length,
-            content_type ? content_type : "application/octet-stream");
-    g_object_unref(stream);
-
 done:
-    if (content_type)
-        g_free(content_type);
+    g_task_return_boolean(task, TRUE);
+}
+
+#if WEBKIT_CHECK_VERSION(2, 36, 0)
+static void format_http_date(time_t t, char *buf, size_t sz)
+{
+    static const char *days[] = {
+        "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+    static const char *months[] = {
+        "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+    struct tm tm;
+
+    gmtime_r(&t, &tm);
+    snprintf(buf, sz, "%s, %02d %s %04d %02d:%02d:%02d GMT",
+            days[tm.tm_wday], tm.tm_mday, months[tm.tm_mon],
+            tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec);
+}
+
+static void finish_asset_load(struct asset_load *load)
+{
+    GInputStream *stream = load->stream;
+    gsize length = load->meta.length;
+    if (load->not_modified) {
+        stream = g_memory_input_stream_new();
+        length = 0;
+    }
+
+    WebKitURISchemeResponse *response;
+    response = webkit_uri_scheme_response_new(stream, length);
+
+    SoupMessageHeaders *headers;
+    headers = soup_message_headers_new(SOUP_MESSAGE_HEADERS_RESPONSE);
+    if (load->flags & ASSET_FLAG_ONCE) {
+        soup_message_headers_append(headers, "Cache-Control", "no-store");
+    }
+    else if (load->meta.etag) {
+        /* the built-in assets only change with the renderer */
+        soup_message_headers_append(headers, "Cache-Control", load->builtin ?
+                BUILTIN_ASSET_CACHE_CONTROL : APP_ASSET_CACHE_CONTROL);
+        soup_message_headers_append(headers, "ETag", load->meta.etag);
+
+        char date[64];
+        format_http_date(load->meta.last_modified, date, sizeof(date));
+        soup_message_headers_append(headers, "Last-Modified", date);
+    }
+
+    if (load->not_modified) {
+        webkit_uri_scheme_response_set_status(response, 304, NULL);
+        g_object_unref(stream);
+    }
+    else {
+        webkit_uri_scheme_response_set_content_type(response,
+                load->meta.content_type ?
+                load->meta.content_type : "application/octet-stream");
+    }
+    webkit_uri_scheme_response_set_http_headers(response, headers);
+
+    webkit_uri_scheme_request_finish_with_response(load->request, response);
+    g_object_unref(response);
+}
+#else
+static void finish_asset_load(struct asset_load *load)
+{
+    webkit_uri_scheme_request_finish(load->request, load->stream,
+            load->meta.length, load->meta.content_type ?
+            load->meta.content_type : "application/octet-stream");
+}
+#endif
+
+static void start_asset_load(struct asset_load *load);
+
+static void asset_load_done(GObject *source_object, GAsyncResult *result,
+        gpointer user_data)
+{
+    struct asset_load *load = g_task_get_task_data(G_TASK(result));
+    (void)source_object;
+    (void)user_data;
+
+    if (load->not_modified) {
+        /* count the loads avoided by revalidation for the page */
+        WebKitWebView *webview;
+        webview = webkit_uri_scheme_request_get_web_view(load->request);
+        if (webview) {
+            unsigned nr_avoided = GPOINTER_TO_UINT(g_object_get_data(
+                        G_OBJECT(webview), "purcmc-avoided-loads")) + 1;
+            g_object_set_data(G_OBJECT(webview), "purcmc-avoided-loads",
+                    GUINT_TO_POINTER(nr_avoided));
+            LOG_DEBUG("asset %s/%s not modified; %u loads avoided\n",
+                    load->prefix, load->page, nr_avoided);
+        }
+        finish_asset_load(load);
+    }
+    else if (load->stream) {
+        LOG_DEBUG("loaded asset %s/%s (%s)\n", load->prefix, load->page,
+                load->meta.content_type);
+        finish_asset_load(load);
+    }
+    else {
+        webkit_uri_scheme_request_finish_error(load->request, load->error);
+    }
+
+    struct session_asset_loads *loads;
+    loads = g_hash_table_lookup(asset_loads, load->sess);
+    assert(loads);
+
+    struct asset_load *next = g_queue_pop_head(&loads->pending);
+    if (next) {
+        start_asset_load(next);
+    }
+    else if (--loads->nr_running == 0) {
+        g_hash_table_remove(asset_loads, load->sess);
+    }
+}
+
+static void start_asset_load(struct asset_load *load)
+{
+    GTask *task = g_task_new(NULL, NULL, asset_load_done, NULL);
+    g_task_set_task_data(task, load, free_asset_load);
+    g_task_run_in_thread(task, load_asset_in_thread);
+    g_object_unref(task);
+}
+
+/*
+ * Loads a local asset in a thread and finishes the request when done,
+ * so that slow storage does not stall the UI thread. The loads of a
+ * session beyond MAX_ASSET_LOADS_PER_SESSION wait for the running ones.
+ */
+static void load_asset_async(WebKitURISchemeRequest *request,
+        const char *env, const char *prefix, const char *page,
+        unsigned flags, bool builtin)
+{
+    struct asset_load *load = g_new0(struct asset_load, 1);
+    load->request = g_object_ref(request);
+    load->env = g_strdup(env);
+    load->prefix = g_strdup(prefix);
+    load->page = g_strdup(page);
+    load->flags = flags;
+    load->builtin = builtin;
+
+    WebKitWebView *webview = webkit_uri_scheme_request_get_web_view(request);
+    if (webview) {
+        load->sess = g_object_get_data(G_OBJECT(webview), "purcmc-session");
+    }
+
+#if WEBKIT_CHECK_VERSION(2, 36, 0)
+    SoupMessageHeaders *headers;
+    headers = webkit_uri_scheme_request_get_http_headers(request);
+    if (headers) {
+        load->if_none_match = g_strdup(
+                soup_message_headers_get_one(headers, "If-None-Match"));
+    }
+#endif
+
+    if (asset_loads == NULL) {
+        asset_loads = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                NULL, g_free);
+    }
+
+    struct session_asset_loads *loads;
+    loads = g_hash_table_lookup(asset_loads, load->sess);
+    if (loads == NULL) {
+        loads = g_new0(struct session_asset_loads, 1);
+        g_queue_init(&loads->pending);
+        g_hash_table_insert(asset_loads, load->sess, loads);
+    }
+
+    if (loads->nr_running < MAX_ASSET_LOADS_PER_SESSION) {
+        loads->nr_running++;
+        start_asset_load(load);
+    }
+    else {
+        LOG_DEBUG("%u asset loads running; queue %s\n",
+                loads->nr_running, page);
+        g_queue_push_tail(&loads->pending, load);
+    }
+}
+
+void load_local_assets(WebKitURISchemeRequest *request,
+        purcmc_endpoint *endpoint, struct hvml_broken_down_uri *uri_st)
+{
+    (void) endpoint;
+
+    char prefix[PURC_LEN_APP_NAME + PURC_LEN_RUNNER_NAME + 32];
+
+    if (strcmp(uri_st->app, PCRDR_APP_SYSTEM) == 0) {
+        if (strcmp(uri_st->runner, PCRDR_RUNNER_FILESYSTEM) == 0) {
+            /* try to load asset from the system filesystem */
+            strcpy(prefix, "/");
+        }
+        else {
+            /* TODO */
+            strcpy(prefix, "/");
+        }
+    }
+    else {
+        snprintf(prefix, sizeof(prefix), "/app/%s/exported", uri_st->real_app);
+    }
+
+    LOG_WARN("local res: uri=%s|prefix=%s|page=%s\n", uri_st->uri, prefix, uri_st->page);
+
+    unsigned asset_flags = 0;
+    char *once_val = NULL;
+    if (purc_hvml_uri_get_query_value_alloc(uri_st->uri,
+                "once", &once_val) && strcmp(once_val, "yes") == 0) {
+        asset_flags |= ASSET_FLAG_ONCE;
+    }
+    if (once_val)
+        free(once_val);
+
+    load_asset_async(request, NULL, prefix, uri_st->page, asset_flags, false);
 }
 
 void handle_origin_host_request(WebKitURISchemeRequest *request,
@@ -624,9 +884,9 @@ void hvmlURISchemeRequestCallback(WebKitURISchemeRequest *request,
         WebKitWebContext *webContext)
 {
     const char *uri = webkit_uri_scheme_request_get_uri(request);
-    char host[PURC_LEN_HOST_NAME + 1];
-    char app[PURC_LEN_APP_NAME + 1];
-    char runner[PURC_LEN_RUNNER_NAME + 1];
+    char host[PURC_LEN_HOST_NAME + 1] = "";
+    char app[PURC_LEN_APP_NAME + 1] = "";
+    char runner[PURC_LEN_RUNNER_NAME + 1] = "";
 
     char *group = NULL;
     char *page = NULL;
@@ -644,9 +904,21 @@ void hvmlURISchemeRequestCallback(WebKitURISchemeRequest *request,
     GError *error = NULL;
     gchar *error_str = NULL;
 
-    if (!purc_hvml_uri_split(uri,
-            host, app, runner, NULL, NULL) ||
-            !purc_is_valid_host_name(host) ||
+    /* split the URI once and only copy the components */
+    struct hvml_uri_views views;
+    if (!hvml_uri_split_views(uri, &views) ||
+            views.host.len > PURC_LEN_HOST_NAME ||
+            views.app.len > PURC_LEN_APP_NAME ||
+            views.runner.len > PURC_LEN_RUNNER_NAME) {
+        error_str = g_strdup_printf(
+                "Invalid HVML URI (%s): bad host, app, or runner name", uri);
+        goto error;
+    }
+
+    g_strlcpy(host, uri + views.host.off, views.host.len + 1);
+    g_strlcpy(app, uri + views.app.off, views.app.len + 1);
+    g_strlcpy(runner, uri + views.runner.off, views.runner.len + 1);
+    if (!purc_is_valid_host_name(host) ||
             !purc_is_valid_app_name(app) ||
             !purc_is_valid_runner_name(runner)) {
         error_str = g_strdup_printf(
@@ -654,14 +926,46 @@ void hvmlURISchemeRequestCallback(WebKitURISchemeRequest *request,
         goto error;
     }
 
-    if (!purc_hvml_uri_split_alloc(uri, NULL, NULL, NULL, &group, &page)) {
+    if (views.page.len == 0) {
         error_str = g_strdup_printf(
                 "Invalid HVML URI (%s): bad group or page name", uri);
         goto error;
     }
 
+    group = strndup(uri + views.group.off, views.group.len);
+    page = strndup(uri + views.page.off, views.page.len);
+
     LOG_DEBUG("Try to load asset for URI: %s\n", uri);
 
+    /* a document written in chunks to a page of any host; WebKit parses
+       the chunks as they are fed to the stream */
+    char *stream_val = NULL;
+    if (purc_hvml_uri_get_query_value_alloc(uri, "stream", &stream_val)) {
+        free(stream_val);
+
+        /* only the main resource of the current stream takes it */
+        WebKitWebView *webview;
+        webview = webkit_uri_scheme_request_get_web_view(request);
+        struct doc_stream *ds = NULL;
+        if (webview) {
+            const char *stream_uri = g_object_get_data(G_OBJECT(webview),
+                    DOC_STREAM_URI_KEY);
+            if (stream_uri && strcmp(stream_uri, uri) == 0)
+                ds = g_object_get_data(G_OBJECT(webview), DOC_STREAM_KEY);
+        }
+        GInputStream *input = ds ? doc_stream_take_input(ds) : NULL;
+        if (input) {
+            webkit_uri_scheme_request_finish(request, input, -1,
+                    "text/html");
+            g_object_unref(input);
+            goto done;
+        }
+
+        error_str = g_strdup_printf(
+                "Invalid HVML URI (%s): no document stream", uri);
+        goto error;
+    }
+
     /* check if it is an asset which was built in the renderer */
     if (strcmp(host, PCRDR_LOCALHOST) == 0 &&
             strcmp(app, PCRDR_APP_RENDERER) == 0 &&
@@ -679,18 +983,11 @@ void hvmlURISchemeRequestCallback(WebKitURISchemeRequest *request,
         finish_with_redirect(request, rpath);
         goto done;
 #else
-        contents = open_and_load_asset("WEBKIT_WEBEXT_DIR", WEBKIT_WEBEXT_DIR,
-                page, &max_to_load, &fd, &content_length);
+        load_asset_async(request, "WEBKIT_WEBEXT_DIR", WEBKIT_WEBEXT_DIR,
+                page, 0, true);
+        goto done;
 #endif
 #endif
-
-        if (contents == NULL) {
-            error = g_error_new(XGUI_PRO_ERROR,
-                    XGUI_PRO_ERROR_INVALID_HVML_URI,
-                    "Can not load contents from asset file (%s)", page);
-            webkit_uri_scheme_request_finish_error(request, error);
-            goto done;
-        }
     }
     else if (strcmp(host, PCRDR_LOCALHOST) == 0) {
         char prefix[PURC_LEN_APP_NAME + PURC_LEN_RUNNER_NAME + 32];
@@ -778,26 +1075,8 @@ void hvmlURISchemeRequestCallback(WebKitURISchemeRequest *request,
         if (once_val)
             free(once_val);
 
-        if (asset_flags & ASSET_FLAG_ONCE) {
-            /* If having ASSET_FLAG_ONCE load whole contents, and remove
-               the asset file. */
-            contents = load_asset_content(NULL, prefix, page, &content_length,
-                    asset_flags);
-            max_to_load = content_length;
-        }
-        else {
-            contents = open_and_load_asset(NULL, prefix, page, &max_to_load,
-                    &fd, &content_length);
-        }
-
-        if (contents == NULL) {
-            error = g_error_new(XGUI_PRO_ERROR,
-                    XGUI_PRO_ERROR_INVALID_HVML_URI,
-                    "Can not load contents from file system (%s/%s)",
-                    prefix, page);
-            webkit_uri_scheme_request_finish_error(request, error);
-            goto done;
-        }
+        load_asset_async(request, NULL, prefix, page, asset_flags, false);
+        goto done;
     }
     else if (strncmp(host, PCRDR_ORIGINHOST, strlen(PCRDR_ORIGINHOST)) == 0) {
         struct hvml_broken_down_uri uri_st = {
@@ -837,19 +1116,10 @@ error:
         max_to_load = content_length;
     }
     else {
-        gboolean result_uncertain;
-        content_type = g_content_type_guess(page,
-                (const guchar *)contents, max_to_load, &result_uncertain);
-
-        LOG_DEBUG("content type of URI (%s): %s (%s)\n",
-                uri, content_type,
-                result_uncertain ? "uncertain" : "certain");
-
-        if (result_uncertain) {
-            if (content_type)
-                free(content_type);
-            content_type = NULL;
-        }
+        content_type = guess_content_type(page,
+                (const guchar *)contents, max_to_load);
+
+        LOG_DEBUG("content type of URI (%s): %s\n", uri, content_type);
     }
 
     GInputStream *stream = NULL;
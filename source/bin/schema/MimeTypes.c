@@ -0,0 +1,108 @@
+/*
+** MimeTypes.c -- The content types of the assets served by the renderer.
+**
+** Copyright (C) 2023 FMSoft (http://www.fmsoft.cn)
+**
+** This file is part of xGUI Pro, an advanced HVML renderer.
+**
+** xGUI Pro is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** xGUI Pro is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see http://www.gnu.org/licenses/.
+*/
+
+#include "config.h"
+
+#include "MimeTypes.h"
+
+#include <gio/gio.h>
+#include <string.h>
+
+/* generated by gperf from MimeTypes.gperf */
+#include "MimeTypesTable.h"
+
+/* the maximum number of the sniffed types remembered */
+#define MAX_SNIFFED_TYPES   1024
+
+/* the value remembered for the paths with an uncertain type */
+static const char uncertain_type[] = "";
+
+G_LOCK_DEFINE_STATIC(sniffed_types);
+
+/* path -> content type or uncertain_type */
+static GHashTable *sniffed_types;
+
+const char *mime_type_from_extension(const char *path)
+{
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+
+    const char *ext = strrchr(base, '.');
+    if (ext == NULL || ext[1] == '\0')
+        return NULL;
+
+    ext++;
+    const struct mime_type_entry *entry = mime_type_lookup(ext, strlen(ext));
+    return entry ? entry->type : NULL;
+}
+
+static void free_sniffed_type(gpointer data)
+{
+    if (data != uncertain_type)
+        g_free(data);
+}
+
+gchar *guess_content_type(const char *path, const guchar *data, gsize length)
+{
+    const char *type = mime_type_from_extension(path);
+    if (type)
+        return g_strdup(type);
+
+    gchar *sniffed;
+    G_LOCK(sniffed_types);
+    if (sniffed_types == NULL) {
+        sniffed_types = g_hash_table_new_full(g_str_hash, g_str_equal,
+                g_free, free_sniffed_type);
+    }
+
+    sniffed = g_hash_table_lookup(sniffed_types, path);
+    if (sniffed) {
+        sniffed = (sniffed == uncertain_type) ? NULL : g_strdup(sniffed);
+        G_UNLOCK(sniffed_types);
+        return sniffed;
+    }
+    G_UNLOCK(sniffed_types);
+
+    gboolean result_uncertain;
+    sniffed = g_content_type_guess(path, data, length, &result_uncertain);
+    if (result_uncertain) {
+        g_free(sniffed);
+        sniffed = NULL;
+    }
+
+    G_LOCK(sniffed_types);
+    if (g_hash_table_size(sniffed_types) >= MAX_SNIFFED_TYPES)
+        g_hash_table_remove_all(sniffed_types);
+    g_hash_table_replace(sniffed_types, g_strdup(path),
+            sniffed ? g_strdup(sniffed) : (gchar *)uncertain_type);
+    G_UNLOCK(sniffed_types);
+
+    return sniffed;
+}
+
+void mime_types_cleanup(void)
+{
+    G_LOCK(sniffed_types);
+    if (sniffed_types) {
+        g_hash_table_destroy(sniffed_types);
+        sniffed_types = NULL;
+    }
+    G_UNLOCK(sniffed_types);
+}
@@ -0,0 +1,52 @@
+/*
+** MimeTypes.h -- The content types of the assets served by the renderer.
+**
+** Copyright (C) 2023 FMSoft (http://www.fmsoft.cn)
+**
+** This file is part of xGUI Pro, an advanced HVML renderer.
+**
+** xGUI Pro is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** xGUI Pro is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef MimeTypes_h
+#define MimeTypes_h
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Returns the MIME type registered for the extension of the file in `path`,
+ * or NULL if the extension is not a common one for the web.
+ */
+const char *mime_type_from_extension(const char *path);
+
+/*
+ * Returns the content type of the asset in `path` as a string to free with
+ * g_free(), or NULL if it is uncertain. The type comes from the extension
+ * table if the extension is known; otherwise it is sniffed from the first
+ * `length` bytes of `data`, and the result is remembered for the path.
+ * It is safe to call this function from any thread.
+ */
+gchar *guess_content_type(const char *path, const guchar *data, gsize length);
+
+/* Forgets the remembered content types. */
+void mime_types_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* MimeTypes_h */
@@ -0,0 +1,158 @@
+/*
+** test_hvml_uri.c -- The tests and benchmarks of HVML URI splitting.
+**
+** Copyright (C) 2023 FMSoft (http://www.fmsoft.cn)
+**
+** This file is part of xGUI Pro, an advanced HVML renderer.
+**
+** xGUI Pro is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** xGUI Pro is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see http://www.gnu.org/licenses/.
+*/
+
+#undef NDEBUG
+
+#include "utils/hvml-uri.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+
+#define DEF_NR_ROUNDS       1000000
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static const char *good_uris[] = {
+    "hvml://localhost/cn.fmsoft.hvml.test/main/-/index.html",
+    "hvml://localhost:8080/app/_https/-/css/style.css?once=yes",
+    "HVML://localhost/app/_file/group/img/logo.png?a=b&c=d#frag",
+    "hvml://localhost/_renderer/_builtin/-/assets/hvml.js",
+};
+
+static const char *partial_uris[] = {
+    "hvml://localhost/app/runner/",
+    "hvml://localhost/app/runner/group/",
+    "hvml://localhost/app/runner/group//page",
+};
+
+static const char *bad_uris[] = {
+    "http://localhost/app/runner/-/page",
+    "hvml:///app/runner/-/page",
+    "hvml://localhost//runner/-/page",
+    "hvml://localhost/app",
+};
+
+static bool view_equals(const char *uri, const struct hvml_uri_view *view,
+        const char *str)
+{
+    return strlen(str) == view->len &&
+        strncmp(uri + view->off, str, view->len) == 0;
+}
+
+static void test_views(void)
+{
+    struct hvml_uri_views views;
+
+    for (size_t i = 0; i < sizeof(good_uris) / sizeof(good_uris[0]); i++) {
+        const char *uri = good_uris[i];
+        char *host, *app, *runner, *group, *page;
+
+        assert(hvml_uri_split_views(uri, &views));
+        assert(hvml_uri_split_alloc(uri, &host, &app, &runner, &group, &page));
+        assert(view_equals(uri, &views.host, host));
+        assert(view_equals(uri, &views.app, app));
+        assert(view_equals(uri, &views.runner, runner));
+        assert(view_equals(uri, &views.group, group));
+        assert(view_equals(uri, &views.page, page));
+        free(host);
+        free(app);
+        free(runner);
+        free(group);
+        free(page);
+    }
+
+    assert(hvml_uri_split_views(good_uris[1], &views));
+    assert(view_equals(good_uris[1], &views.query, "once=yes"));
+    assert(hvml_uri_split_views(good_uris[2], &views));
+    assert(view_equals(good_uris[2], &views.query, "a=b&c=d"));
+    assert(hvml_uri_split_views(good_uris[0], &views));
+    assert(views.query.len == 0);
+
+    for (size_t i = 0; i < sizeof(partial_uris) / sizeof(partial_uris[0]);
+            i++) {
+        char runner[64];
+
+        assert(hvml_uri_split_views(partial_uris[i], &views));
+        assert(views.page.len == 0 && views.group.len == 0);
+        assert(hvml_uri_split(partial_uris[i], NULL, NULL, runner, NULL, NULL));
+        assert(strcmp(runner, "runner") == 0);
+        assert(!hvml_uri_split(partial_uris[i], NULL, NULL, NULL, NULL, runner));
+    }
+
+    for (size_t i = 0; i < sizeof(bad_uris) / sizeof(bad_uris[0]); i++) {
+        assert(!hvml_uri_split_views(bad_uris[i], &views));
+        assert(!hvml_uri_split(bad_uris[i], NULL, NULL, NULL, NULL, NULL));
+    }
+}
+
+static void bench(size_t nr_rounds)
+{
+    const size_t nr_uris = sizeof(good_uris) / sizeof(good_uris[0]);
+    struct hvml_uri_views views;
+    size_t total = 0;
+    double t0, t_alloc, t_views;
+
+    t0 = now_ms();
+    for (size_t i = 0; i < nr_rounds; i++) {
+        char *host, *app, *runner, *group, *page;
+        assert(hvml_uri_split_alloc(good_uris[i % nr_uris],
+                    &host, &app, &runner, &group, &page));
+        total += strlen(page);
+        free(host);
+        free(app);
+        free(runner);
+        free(group);
+        free(page);
+    }
+    t_alloc = now_ms() - t0;
+
+    t0 = now_ms();
+    for (size_t i = 0; i < nr_rounds; i++) {
+        assert(hvml_uri_split_views(good_uris[i % nr_uris], &views));
+        total -= views.page.len;
+    }
+    t_views = now_ms() - t0;
+    assert(total == 0);
+
+    printf("%zu splits: alloc %.2f ms (%.0f/s), views %.2f ms (%.0f/s)\n",
+            nr_rounds, t_alloc, nr_rounds * 1000.0 / t_alloc,
+            t_views, nr_rounds * 1000.0 / t_views);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t nr_rounds = DEF_NR_ROUNDS;
+
+    if (argc > 1)
+        nr_rounds = strtoul(argv[1], NULL, 10);
+
+    test_views();
+    bench(nr_rounds);
+
+    return EXIT_SUCCESS;
+}
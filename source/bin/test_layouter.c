@@ -32,8 +32,10 @@
 
 #include <purc/purc.h>
 
+#include <stdarg.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
 #include <assert.h>
 
 #define SA_INITIAL_SIZE 16
@@ -234,12 +236,283 @@ static const char *new_page_groups = ""
     "<section id='theModals'>"
     "</section>";
 
+/*
+ * The benchmark mode: `test_layouter --bench [max_scale] [output.json]`.
+ *
+ * For each scale N (10, 100, ... up to max_scale), a synthetic workspace
+ * with N groups (a section with an article holding a pane host and a tab
+ * host) is generated and N panes/tabs are added to it. The results are
+ * written as JSON so that they can be compared across commits.
+ */
+#define BENCH_DEF_MAX_SCALE     1000
+#define BENCH_MAX_OPS           100
+
+struct bench_ctxt {
+    unsigned long nr_created;
+    unsigned long nr_destroyed;
+    unsigned long nr_updated;
+};
+
+struct bench_widget {
+    int x, y;
+    unsigned w, h;
+};
+
+static void *bench_create_widget(void *workspace, void *session,
+        ws_widget_type_t type, void *window, void *parent, void *init_arg,
+        const struct ws_widget_info *style)
+{
+    struct bench_ctxt *ctxt = workspace;
+    struct bench_widget *widget = malloc(sizeof(*widget));
+
+    assert(widget);
+    widget->x = style->x;
+    widget->y = style->y;
+    widget->w = style->w;
+    widget->h = style->h;
+    ctxt->nr_created++;
+    return widget;
+}
+
+static int bench_destroy_widget(void *workspace, void *session,
+        void *window, void *widget, ws_widget_type_t type)
+{
+    struct bench_ctxt *ctxt = workspace;
+
+    free(widget);
+    ctxt->nr_destroyed++;
+    return PCRDR_SC_OK;
+}
+
+static void bench_update_widget(void *workspace, void *session, void *widget,
+        ws_widget_type_t type, const struct ws_widget_info *style)
+{
+    struct bench_ctxt *ctxt = workspace;
+    struct bench_widget *w = widget;
+
+    if (style->flags & WSWS_FLAG_GEOMETRY) {
+        w->x = style->x;
+        w->y = style->y;
+        w->w = style->w;
+        w->h = style->h;
+    }
+    ctxt->nr_updated++;
+}
+
+static double bench_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+struct bench_buf {
+    char *data;
+    size_t len;
+    size_t size;
+};
+
+static void bench_buf_printf(struct bench_buf *buf, const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    for (;;) {
+        va_start(ap, fmt);
+        n = vsnprintf(buf->data + buf->len, buf->size - buf->len, fmt, ap);
+        va_end(ap);
+        assert(n >= 0);
+
+        if (buf->len + n < buf->size)
+            break;
+
+        buf->size = (buf->size + n + 1) * 2;
+        buf->data = realloc(buf->data, buf->size);
+        assert(buf->data);
+    }
+
+    buf->len += n;
+}
+
+static void bench_make_workspace(struct bench_buf *html, unsigned nr_groups)
+{
+    bench_buf_printf(html, "<html><head><style>"
+            ".viewer { width:100%%; height:100px; }"
+            ".panel { width:100%%; height:20px; }"
+            ".main { width:100%%; height:60px; }"
+            "</style></head><body>");
+
+    for (unsigned i = 0; i < nr_groups; i++) {
+        bench_buf_printf(html, "<section id='s%u'>"
+                "<article id='g%u' class='viewer'>"
+                "<ol id='g%u-panes' class='panel'></ol>"
+                "<ul id='g%u-tabs' class='main'></ul>"
+                "</article></section>", i, i, i, i);
+    }
+
+    bench_buf_printf(html, "</body></html>");
+}
+
+static void bench_group_id(char *buf, size_t sz, unsigned nr_groups,
+        unsigned i)
+{
+    snprintf(buf, sz, "g%u-%s", i % nr_groups, (i & 1) ? "tabs" : "panes");
+}
+
+static void bench_one_scale(struct bench_buf *json, unsigned scale)
+{
+    struct ws_metrics metrics = { 1024, 768, 96, 1 };
+    struct bench_ctxt ctxt = { 0, 0, 0 };
+    struct bench_buf html = { NULL, 0, 0 };
+    unsigned nr_ops = (scale < BENCH_MAX_OPS) ? scale : BENCH_MAX_OPS;
+    char group[32], name[32];
+    double t0, t_new, t_add, t_update, t_remove, t_relayout, t_delete;
+    int retv;
+
+    bench_make_workspace(&html, scale);
+
+    t0 = bench_now_us();
+    struct ws_layouter *layouter;
+    layouter = ws_layouter_new(&metrics, html.data, html.len, &ctxt,
+            my_convert_style, bench_create_widget, bench_destroy_widget,
+            bench_update_widget, &retv);
+    t_new = bench_now_us() - t0;
+    assert(layouter);
+    free(html.data);
+
+    void **widgets = calloc(scale, sizeof(void *));
+    t0 = bench_now_us();
+    for (unsigned i = 0; i < scale; i++) {
+        bench_group_id(group, sizeof(group), scale, i);
+        snprintf(name, sizeof(name), "w%u", i);
+        widgets[i] = ws_layouter_add_widget(layouter, NULL, group, name,
+                NULL, NULL, NULL, PURC_VARIANT_INVALID, NULL, &retv);
+        assert(retv == PCRDR_SC_OK && widgets[i]);
+    }
+    t_add = bench_now_us() - t0;
+
+    purc_variant_t classes[2];
+    classes[0] = purc_variant_make_string_static("panel", false);
+    classes[1] = purc_variant_make_string_static("main", false);
+
+    t0 = bench_now_us();
+    for (unsigned i = 0; i < nr_ops; i++) {
+        retv = ws_layouter_update_widget(layouter, NULL, widgets[i],
+                "class", classes[i & 1]);
+        assert(retv == PCRDR_SC_OK);
+    }
+    t_update = bench_now_us() - t0;
+
+    /* a relayout with many dirty widgets */
+    ws_layouter_begin_batch(layouter);
+    for (unsigned i = 0; i < nr_ops; i++) {
+        ws_layouter_update_widget(layouter, NULL, widgets[i],
+                "class", classes[(i + 1) & 1]);
+    }
+    t0 = bench_now_us();
+    ws_layouter_commit(layouter, NULL);
+    t_relayout = bench_now_us() - t0;
+
+    purc_variant_unref(classes[0]);
+    purc_variant_unref(classes[1]);
+
+    t0 = bench_now_us();
+    for (unsigned i = 0; i < nr_ops; i++) {
+        bench_group_id(group, sizeof(group), scale, i);
+        snprintf(name, sizeof(name), "w%u", i);
+        retv = ws_layouter_remove_widget_by_id(layouter, NULL, group, name);
+        assert(retv == PCRDR_SC_OK);
+    }
+    t_remove = bench_now_us() - t0;
+    free(widgets);
+
+    struct ws_layouter_stats stats;
+    ws_layouter_get_stats(layouter, &stats);
+
+    t0 = bench_now_us();
+    ws_layouter_delete(layouter, NULL);
+    t_delete = bench_now_us() - t0;
+    assert(ctxt.nr_created == ctxt.nr_destroyed);
+
+    bench_buf_printf(json, "%s\n    {\n"
+            "      \"groups\": %u,\n"
+            "      \"widgets\": %u,\n"
+            "      \"ops\": %u,\n"
+            "      \"new_ms\": %.3f,\n"
+            "      \"add_widget_us\": %.3f,\n"
+            "      \"update_widget_us\": %.3f,\n"
+            "      \"remove_widget_by_id_us\": %.3f,\n"
+            "      \"relayout_ms\": %.3f,\n"
+            "      \"delete_ms\": %.3f,\n"
+            "      \"relayouts\": %lu,\n"
+            "      \"geometry_applied\": %lu,\n"
+            "      \"geometry_suppressed\": %lu\n"
+            "    }",
+            (json->data[json->len - 1] == '[') ? "" : ",",
+            scale, scale, nr_ops,
+            t_new / 1000.0, t_add / scale, t_update / nr_ops,
+            t_remove / nr_ops, t_relayout / 1000.0, t_delete / 1000.0,
+            stats.nr_relayouts, stats.nr_geometry_applied,
+            stats.nr_geometry_suppressed);
+}
+
+static int run_benchmark(int argc, char *argv[])
+{
+    unsigned max_scale = BENCH_DEF_MAX_SCALE;
+    const char *output = NULL;
+
+    if (argc > 0)
+        max_scale = (unsigned)strtoul(argv[0], NULL, 10);
+    if (argc > 1)
+        output = argv[1];
+
+    int ret = purc_init_ex(PURC_MODULE_VARIANT, "cn.fmsoft.hvml.xguipro",
+            "test_layouter", NULL);
+    if (ret != PURC_ERROR_OK) {
+        fprintf(stderr, "Failed to initialize PurC: %s\n",
+                purc_get_error_message(ret));
+        return EXIT_FAILURE;
+    }
+
+    struct bench_buf json = { NULL, 0, 0 };
+    bench_buf_printf(&json, "{\n  \"benchmark\": \"layouter\",\n"
+            "  \"version\": \"%s\",\n  \"results\": [",
+            XGUIPRO_VERSION_STRING);
+
+    for (unsigned scale = 10; scale <= max_scale; scale *= 10) {
+        bench_one_scale(&json, scale);
+    }
+
+    bench_buf_printf(&json, "\n  ]\n}\n");
+
+    FILE *fp = output ? fopen(output, "w") : stdout;
+    if (fp == NULL) {
+        fprintf(stderr, "Failed to open %s: %s\n", output, strerror(errno));
+        ret = EXIT_FAILURE;
+    }
+    else {
+        fwrite(json.data, 1, json.len, fp);
+        if (fp != stdout)
+            fclose(fp);
+        ret = EXIT_SUCCESS;
+    }
+
+    free(json.data);
+    ws_layouter_cleanup_cache();
+    purc_cleanup();
+    return ret;
+}
+
 int main(int argc, char *argv[])
 {
     int retv;
     struct test_ctxt ctxt;
     struct ws_metrics metrics = { 1024, 768, 96, 1 };
 
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        return run_benchmark(argc - 2, argv + 2);
+    }
+
     ctxt.sa_widget = sorted_array_create(SAFLAG_DEFAULT,
             SA_INITIAL_SIZE, NULL, NULL);
     assert(ctxt.sa_widget);
@@ -338,6 +611,12 @@ int main(int argc, char *argv[])
         PURC_VARIANT_INVALID, NULL, &retv);
     assert(retv == PCRDR_SC_OK);
 
+    /* the widgets created in a batch are laid out once */
+    struct ws_layouter_stats stats;
+    ws_layouter_get_stats(layouter, &stats);
+    unsigned long nr_box_layouts = stats.nr_box_layouts;
+
+    ws_layouter_begin_batch(layouter);
     ws_layouter_add_widget(layouter, NULL,
         "viewerBodyTabs", "tab1", NULL, NULL, NULL,
         PURC_VARIANT_INVALID, NULL, &retv);
@@ -348,6 +627,10 @@ int main(int argc, char *argv[])
         PURC_VARIANT_INVALID, NULL, &retv);
     assert(retv == PCRDR_SC_OK);
     assert(widget != NULL);
+    ws_layouter_commit(layouter, NULL);
+
+    ws_layouter_get_stats(layouter, &stats);
+    assert(stats.nr_box_layouts == nr_box_layouts + 1);
 
     ws_widget_type_t type;
     type = ws_layouter_retrieve_widget_by_id(layouter, "theModals", "test3");
@@ -364,6 +647,15 @@ int main(int argc, char *argv[])
     type = ws_layouter_retrieve_widget(layouter, widget);
     assert(type == WS_WIDGET_TYPE_TABBEDPAGE);
 
+    type = ws_layouter_get_page_type(layouter, "viewerBodyTabs");
+    assert(type == WS_WIDGET_TYPE_TABBEDPAGE);
+
+    type = ws_layouter_get_page_type(layouter, "viewerBodyPanels");
+    assert(type == WS_WIDGET_TYPE_PANEDPAGE);
+
+    type = ws_layouter_get_page_type(layouter, "viewerBody");
+    assert(type == WS_WIDGET_TYPE_NONE);
+
     retv = ws_layouter_remove_widget_by_id(layouter, NULL,
             "viewerBodyPanels", "panel1");
     assert(retv == PCRDR_SC_OK);
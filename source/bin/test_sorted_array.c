@@ -0,0 +1,187 @@
+/*
+** test_sorted_array.c -- The tests and benchmarks of sorted array.
+**
+** Copyright (C) 2022 FMSoft (http://www.fmsoft.cn)
+**
+** This file is part of xGUI Pro, an advanced HVML renderer.
+**
+** xGUI Pro is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** xGUI Pro is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see http://www.gnu.org/licenses/.
+*/
+
+#undef NDEBUG
+
+#include "utils/sorted-array.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+
+#define DEF_MAX_MEMBERS     1000000
+
+/* adding random members one by one is quadratic anyway; skip it beyond */
+#define MAX_MEMBERS_TO_ADD  100000
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/* xorshift64; deterministic for reproducible runs */
+static uint64_t next_random(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+static void check_sorted(struct sorted_array *sa, size_t expected)
+{
+    size_t n = sorted_array_count(sa);
+    assert(n == expected);
+
+    uint64_t last = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t v = sorted_array_get(sa, i, NULL);
+        assert(i == 0 || v > last);
+        last = v;
+    }
+}
+
+static void bench(size_t nr)
+{
+    uint64_t *keys = malloc(sizeof(uint64_t) * nr);
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    double t0, t_add, t_build, t_find, t_remove;
+
+    assert(keys);
+    for (size_t i = 0; i < nr; i++)
+        keys[i] = next_random(&state);
+
+    /* one by one */
+    struct sorted_array *sa;
+    t_add = -1;
+    if (nr <= MAX_MEMBERS_TO_ADD) {
+        sa = sorted_array_create(SAFLAG_DEFAULT, 0, NULL, NULL);
+        t0 = now_ms();
+        for (size_t i = 0; i < nr; i++)
+            assert(sorted_array_add(sa, keys[i], NULL) == 0);
+        t_add = now_ms() - t0;
+        check_sorted(sa, nr);
+        sorted_array_destroy(sa);
+    }
+
+    /* bulk build; append every key twice to exercise deduplication */
+    sa = sorted_array_create(SAFLAG_DEFAULT, 0, NULL, NULL);
+    t0 = now_ms();
+    for (size_t i = 0; i < nr; i++)
+        assert(sorted_array_append(sa, keys[i], (void *)(uintptr_t)i) == 0);
+    for (size_t i = 0; i < nr; i++)
+        assert(sorted_array_append(sa, keys[i], NULL) == 0);
+    assert(sorted_array_build(sa) == 0);
+    t_build = now_ms() - t0;
+    check_sorted(sa, nr);
+
+    t0 = now_ms();
+    for (size_t i = 0; i < nr; i++) {
+        void *data;
+        assert(sorted_array_find(sa, keys[i], &data));
+        assert((uintptr_t)data == i);
+    }
+    t_find = now_ms() - t0;
+
+    /* remove a half in one batch */
+    t0 = now_ms();
+    assert(sorted_array_remove_batch(sa, keys, nr / 2) == nr / 2);
+    t_remove = now_ms() - t0;
+    check_sorted(sa, nr - nr / 2);
+    assert(!sorted_array_find(sa, keys[0], NULL));
+    assert(sorted_array_find(sa, keys[nr - 1], NULL));
+    sorted_array_destroy(sa);
+
+    char add[32];
+    if (t_add < 0)
+        strcpy(add, "-");
+    else
+        snprintf(add, sizeof(add), "%.2f", t_add);
+    printf("%8zu members: add %10s ms, build %8.2f ms, "
+            "find %8.2f ms, remove half %8.2f ms\n",
+            nr, add, t_build, t_find, t_remove);
+    free(keys);
+}
+
+static void test_order(void)
+{
+    struct sorted_array *sa;
+
+    sa = sorted_array_create(SAFLAG_ORDER_DESC | SAFLAG_DUPLCATE_SORTV, 0,
+            NULL, NULL);
+    for (uint64_t v = 0; v < 100; v++) {
+        assert(sorted_array_add(sa, v % 10, NULL) == 0);
+    }
+    for (uint64_t v = 0; v < 100; v++) {
+        assert(sorted_array_append(sa, v % 10, NULL) == 0);
+    }
+    assert(sorted_array_build(sa) == 0);
+    assert(sorted_array_count(sa) == 200);
+    for (size_t i = 1; i < 200; i++) {
+        assert(sorted_array_get(sa, i - 1, NULL) >=
+                sorted_array_get(sa, i, NULL));
+    }
+
+    uint64_t to_remove[] = { 9, 9, 0, 42 };
+    assert(sorted_array_remove_batch(sa, to_remove, 4) == 2);
+    assert(sorted_array_count(sa) == 198);
+    assert(sorted_array_remove(sa, 5));
+    assert(sorted_array_count(sa) == 197);
+    sorted_array_destroy(sa);
+}
+
+/* count and get without building the array after appending duplicates */
+static void test_count_pending(void)
+{
+    struct sorted_array *sa;
+
+    sa = sorted_array_create(SAFLAG_DEFAULT, 0, NULL, NULL);
+    for (uint64_t v = 0; v < 100; v++) {
+        assert(sorted_array_append(sa, v % 10, NULL) == 0);
+    }
+
+    size_t n = sorted_array_count(sa);
+    assert(n == 10);
+    for (size_t i = 0; i < n; i++) {
+        assert(sorted_array_get(sa, i, NULL) == i);
+    }
+    sorted_array_destroy(sa);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t max = DEF_MAX_MEMBERS;
+
+    if (argc > 1)
+        max = strtoul(argv[1], NULL, 10);
+
+    test_order();
+    test_count_pending();
+    for (size_t nr = 10000; nr <= max; nr *= 10) {
+        bench(nr);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -52,6 +52,14 @@
 #define SCHEMA_FTPS                 "ftps"
 #define SCHEMA_FILE                 "file"
 
+/* the number of translated URLs remembered for a page */
+#define NR_TRANSLATED_URLS          32
+
+struct translated_url {
+    char *url;
+    char *res_url;
+};
+
 struct HVMLInfo {
     const char* vendor;
     int   version;
@@ -66,6 +74,10 @@ struct HVMLInfo {
     JSCValue *onrequest;
     JSCValue *onresponse;
     JSCValue *onevent;
+
+    /* the recently translated URLs; the most recent one comes first */
+    struct translated_url translated[NR_TRANSLATED_URLS];
+    unsigned nr_translated;
 };
 
 static JSCValue * hvml_get_property(JSCClass *jsc_class,
@@ -201,8 +213,6 @@ static void destroyed_notify(WebKitWebPage* web_page)
             free(info->appName);
         if (info->runnerName)
             free(info->runnerName);
-        if (info->runnerName)
-            free(info->runnerName);
         if (info->groupName)
             free(info->groupName);
         if (info->pageName)
@@ -217,6 +227,11 @@ static void destroyed_notify(WebKitWebPage* web_page)
         if (info->onevent)
             g_object_unref(info->onevent);
 
+        for (unsigned i = 0; i < info->nr_translated; i++) {
+            g_free(info->translated[i].url);
+            g_free(info->translated[i].res_url);
+        }
+
         free(info);
     }
 
@@ -244,130 +259,130 @@ static gboolean on_hvml_post(WebKitWebPage* web_page,
     return TRUE;
 }
 
-static const char *locate_query(const char *url)
+static bool view_equals(const char *url, const struct hvml_uri_view *view,
+        const char *str)
 {
-    const char *query = NULL;
-    query = url;
-    while (*query && *query != QUERY_SEPERATOR) {
-        query++;
-    }
-
-    if (query[0] == 0) {
-        query = NULL;
-    }
-    else {
-        query += 1;
-        if (query[0] == 0) {
-            query = NULL;
-        }
-    }
-    return query;
+    return strncmp(url + view->off, str, view->len) == 0 &&
+        str[view->len] == '\0';
 }
 
-static char *on_hvml_url_translate(WebKitWebPage* web_page,
-        const char *url)
+static char *translate_hvml_url(struct HVMLInfo *info, const char *url)
 {
-    if (strncmp(url, HVML_SCHEMA, strlen(HVML_SCHEMA)) != 0) {
-        return g_strdup(url);
-    }
-
-    struct HVMLInfo *info;
-    info = g_object_get_data(G_OBJECT(web_page), "hvml-instance");
-    g_assert_true(info != NULL);
-
-    char *res_url = NULL;
-    char *host = NULL, *app = NULL, *runner = NULL, *group = NULL, *page = NULL;
-    const char *query = NULL;
-    const char *port = NULL;
-    char schema[LEN_RUNNER_NAME + 1];
+    struct hvml_uri_views views;
+    const char *schema;
     bool is_file_schema = false;
 
-    bool ret = hvml_uri_split_alloc(url, &host, &app, &runner, &group, &page);
-    if (!ret) {
-        goto out;
+    if (!hvml_uri_split_views(url, &views) || views.page.len == 0) {
+        return NULL;
     }
-    query = locate_query(url);
 
-    port = strstr(host, ":");
-    if (port && port[1]) {
-        port = port + 1;
+    if (view_equals(url, &views.runner, RUNNER_HTTP)) {
+        schema = SCHEMA_HTTP;
     }
-
-    if (strcmp(runner, RUNNER_HTTP) == 0) {
-        strcpy(schema, SCHEMA_HTTP);
+    else if (view_equals(url, &views.runner, RUNNER_HTTPS)) {
+        schema = SCHEMA_HTTPS;
     }
-    else if (strcmp(runner, RUNNER_HTTPS) == 0) {
-        strcpy(schema, SCHEMA_HTTPS);
+    else if (view_equals(url, &views.runner, RUNNER_FTP)) {
+        schema = SCHEMA_FTP;
     }
-    else if (strcmp(runner, RUNNER_FTP) == 0) {
-        strcpy(schema, SCHEMA_FTP);
+    else if (view_equals(url, &views.runner, RUNNER_FTPS)) {
+        schema = SCHEMA_FTPS;
     }
-    else if (strcmp(runner, RUNNER_FTPS) == 0) {
-        strcpy(schema, SCHEMA_FTPS);
-    }
-    else if (strcmp(runner, RUNNER_FILE) == 0) {
+    else if (view_equals(url, &views.runner, RUNNER_FILE)) {
         is_file_schema = true;
-        strcpy(schema, SCHEMA_FILE);
+        schema = SCHEMA_FILE;
     }
     else {
-        goto out;
+        return NULL;
     }
 
-    size_t nr_url = LEN_HOST_NAME + LEN_APP_NAME + LEN_RUNNER_NAME;
-
+    const char *host = url + views.host.off;
+    const char *port = memchr(host, ':', views.host.len);
+    int port_len = 0;
     if (port) {
-        nr_url += strlen(port);
+        port++;
+        port_len = host + views.host.len - port;
     }
 
-    if (page) {
-        nr_url += strlen(page);
-    }
+    const char *page = url + views.page.off;
+    int page_len = views.page.len;
 
-    if (query) {
-        nr_url += strlen(query);
-    }
-
-    res_url = g_malloc(nr_url + 1);
-    if (!res_url) {
-        goto out;
+    /* keep the query and the fragment after it */
+    const char *query = page + page_len;
+    if (query[0] != QUERY_SEPERATOR || query[1] == 0) {
+        query = "";
     }
 
     if (is_file_schema) {
-        snprintf(res_url, nr_url, "%s:///app/%s/exported/%s", schema,
-                info->appName, page);
+        return g_strdup_printf("%s:///app/%s/exported/%.*s%s", schema,
+                info->appName, page_len, page, query);
     }
-    else if (port) {
-        snprintf(res_url, nr_url, "%s://%s:%s/%s/exported/%s", schema,
-                info->hostName, port, info->appName, page);
-    }
-    else {
-        snprintf(res_url, nr_url, "%s://%s/%s/exported/%s", schema,
-                info->hostName, info->appName, page);
+    else if (port_len > 0) {
+        return g_strdup_printf("%s://%s:%.*s/%s/exported/%.*s%s", schema,
+                info->hostName, port_len, port, info->appName,
+                page_len, page, query);
     }
 
-    if (query) {
-        strcat(res_url, "?");
-        strcat(res_url, query);
-    }
+    return g_strdup_printf("%s://%s/%s/exported/%.*s%s", schema,
+            info->hostName, info->appName, page_len, page, query);
+}
 
-out:
-    if (host) {
-        free(host);
-    }
-    if (app) {
-        free(app);
+static const char *recall_translated_url(struct HVMLInfo *info,
+        const char *url)
+{
+    for (unsigned i = 0; i < info->nr_translated; i++) {
+        if (strcmp(info->translated[i].url, url) == 0) {
+            struct translated_url hit = info->translated[i];
+            memmove(info->translated + 1, info->translated,
+                    sizeof(hit) * i);
+            info->translated[0] = hit;
+            return hit.res_url;
+        }
     }
-    if (runner) {
-        free(runner);
+
+    return NULL;
+}
+
+static void remember_translated_url(struct HVMLInfo *info,
+        const char *url, const char *res_url)
+{
+    if (info->nr_translated == NR_TRANSLATED_URLS) {
+        /* forget the least recently used one */
+        info->nr_translated--;
+        g_free(info->translated[info->nr_translated].url);
+        g_free(info->translated[info->nr_translated].res_url);
+    }
+
+    memmove(info->translated + 1, info->translated,
+            sizeof(info->translated[0]) * info->nr_translated);
+    info->translated[0].url = g_strdup(url);
+    info->translated[0].res_url = g_strdup(res_url);
+    info->nr_translated++;
+}
+
+static char *on_hvml_url_translate(WebKitWebPage* web_page,
+        const char *url)
+{
+    if (strncmp(url, HVML_SCHEMA, strlen(HVML_SCHEMA)) != 0) {
+        return g_strdup(url);
     }
-    if (group) {
-        free(group);
+
+    struct HVMLInfo *info;
+    info = g_object_get_data(G_OBJECT(web_page), "hvml-instance");
+    g_assert_true(info != NULL);
+
+    const char *res_url = recall_translated_url(info, url);
+    if (res_url) {
+        return g_strdup(res_url);
     }
-    if (page) {
-        free(page);
+
+    char *translated = translate_hvml_url(info, url);
+    if (translated == NULL) {
+        translated = g_strdup(url);
     }
 
-    return res_url ? res_url : g_strdup(url);
+    remember_translated_url(info, url, translated);
+    return translated;
 }
 
 static struct HVMLInfo *create_hvml_instance(JSCContext *context,
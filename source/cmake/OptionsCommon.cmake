@@ -130,6 +130,7 @@ XGUIPRO_CHECK_HAVE_INCLUDE(HAVE_SYS_PARAM_H sys/param.h)
 XGUIPRO_CHECK_HAVE_INCLUDE(HAVE_SYS_TIME_H sys/time.h)
 XGUIPRO_CHECK_HAVE_INCLUDE(HAVE_SYS_TIMEB_H sys/timeb.h)
 XGUIPRO_CHECK_HAVE_INCLUDE(HAVE_SYS_IOCTL_H sys/ioctl.h)
+XGUIPRO_CHECK_HAVE_INCLUDE(HAVE_POLL_H poll.h)
 XGUIPRO_CHECK_HAVE_INCLUDE(HAVE_SYS_SELECT_H sys/select.h)
 XGUIPRO_CHECK_HAVE_INCLUDE(HAVE_SYS_EPOLL_H sys/epoll.h)
 XGUIPRO_CHECK_HAVE_INCLUDE(HAVE_SYS_MOUNT_H sys/mount.h)
@@ -160,6 +161,7 @@ XGUIPRO_CHECK_HAVE_FUNCTION(HAVE_TIMEGM timegm)
 XGUIPRO_CHECK_HAVE_FUNCTION(HAVE_VASPRINTF vasprintf)
 XGUIPRO_CHECK_HAVE_FUNCTION(HAVE_VSYSLOG vsyslog)
 XGUIPRO_CHECK_HAVE_FUNCTION(HAVE_ALLOCA alloca)
+XGUIPRO_CHECK_HAVE_FUNCTION(HAVE_ACCEPT4 accept4)
 
 XGUIPRO_CHECK_HAVE_FUNCTION(HAVE_OPENPTY openpty)
 XGUIPRO_CHECK_HAVE_FUNCTION(HAVE_REALPATH realpath)
@@ -19,12 +19,18 @@ add_definitions(-DXGUIPRO_API_VERSION_STRING="${XGUIPRO_API_VERSION}")
 find_package(GLIB 2.44.0 REQUIRED COMPONENTS gio gio-unix gmodule gobject)
 find_package(PurC 0.9.26 REQUIRED)
 find_package(DOMRuler 0.9.18 REQUIRED)
+find_package(Gperf REQUIRED)
 
 find_package(OpenSSL)
 if (OpenSSL_FOUND)
     XGUIPRO_OPTION_DEFINE(HAVE_LIBSSL "Whether having OpenSSL." PUBLIC ON)
 endif (OpenSSL_FOUND)
 
+find_package(ZLIB)
+if (ZLIB_FOUND)
+    XGUIPRO_OPTION_DEFINE(HAVE_ZLIB "Whether having zlib." PUBLIC ON)
+endif (ZLIB_FOUND)
+
 # Public options specific to the HybridOS port. Do not add any options here unless
 # there is a strong reason we should support changing the value of the option,
 # and the option is not relevant to any other xGUIPro ports.
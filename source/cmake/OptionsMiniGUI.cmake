@@ -20,9 +20,15 @@ add_definitions(-DXGUIPRO_API_VERSION_STRING="${XGUIPRO_API_VERSION}")
 find_package(GLIB 2.44.0 REQUIRED COMPONENTS gio gio-unix gmodule gobject)
 find_package(PurC 0.9.26 REQUIRED)
 find_package(DOMRuler 0.9.16 REQUIRED)
+find_package(Gperf REQUIRED)
 find_package(MiniGUI 5.0.16 REQUIRED COMPONENTS mGEff)
 find_package(CairoHBD REQUIRED)
 
+find_package(ZLIB)
+if (ZLIB_FOUND)
+    XGUIPRO_OPTION_DEFINE(HAVE_ZLIB "Whether having zlib." PUBLIC ON)
+endif (ZLIB_FOUND)
+
 XGUIPRO_OPTION_DEFINE(USE_SOUP2 "Whether to enable usage of Soup 2 instead of Soup 3." PUBLIC ON)
 XGUIPRO_OPTION_DEFINE(USE_ANIMATION "Whether to enable animation." PUBLIC OFF)
 XGUIPRO_OPTION_DEFINE(USE_SCREEN_CAST "Whether to enable screen cast." PUBLIC OFF)
@@ -127,12 +127,13 @@ static unsigned int get_path_trail_len(const char *str)
     return len;
 }
 
-bool hvml_uri_split(const char *uri,
-        char *host, char *app, char *runner, char *group, char *page)
+bool hvml_uri_split_views(const char *uri, struct hvml_uri_views *views)
 {
     static const unsigned int sz_schema = sizeof(HVML_SCHEMA) - 1;
+    const char *start = uri;
     unsigned int len;
 
+    memset(views, 0, sizeof(*views));
     if (strncasecmp(uri, HVML_SCHEMA, sz_schema))
         return false;
 
@@ -140,147 +141,114 @@ bool hvml_uri_split(const char *uri,
     len = get_path_comp_len(uri);
     if (len == 0 || uri[len] != COMP_SEPERATOR)
         return false;
-    if (host) {
-        strncpy(host, uri, len);
-        host[len] = '\0';
-    }
+    views->host.off = uri - start;
+    views->host.len = len;
 
     uri += len + 1;
     len = get_path_comp_len(uri);
     if (len == 0 || uri[len] != COMP_SEPERATOR)
-        goto failed;
-    if (app) {
-        strncpy(app, uri, len);
-        app[len] = '\0';
-    }
+        return false;
+    views->app.off = uri - start;
+    views->app.len = len;
 
     uri += len + 1;
     len = get_path_comp_len(uri);
     if (len == 0 || uri[len] != COMP_SEPERATOR)
-        goto failed;
-    if (runner) {
-        strncpy(runner, uri, len);
-        runner[len] = '\0';
-    }
-
-    if (group == NULL && page == NULL) {
-        /* stop splitting if the caller was not insterested in group and page */
-        return true;
-    }
+        return false;
+    views->runner.off = uri - start;
+    views->runner.len = len;
 
     uri += len + 1;
     len = get_path_comp_len(uri);
     if (len == 0 || uri[len] != COMP_SEPERATOR)
-        goto failed;
-    if (group) {
-        strncpy(group, uri, len);
-        group[len] = '\0';
-    }
+        return true;
+    views->group.off = uri - start;
+    views->group.len = len;
 
     uri += len + 1;
     len = get_path_trail_len(uri);
-    if (len == 0 || uri[0] == COMP_SEPERATOR)
-        goto failed;
+    if (len == 0 || uri[0] == COMP_SEPERATOR) {
+        views->group.len = 0;
+        return true;
+    }
+    views->page.off = uri - start;
+    views->page.len = len;
 
-    if (page) {
-        strncpy(page, uri, len);
-        page[len] = '\0';
+    uri += len;
+    if (*uri == QUERY_SEPERATOR) {
+        uri++;
+        len = 0;
+        while (uri[len] && uri[len] != FRAG_SEPERATOR)
+            len++;
+        views->query.off = uri - start;
+        views->query.len = len;
     }
 
     return true;
+}
 
-failed:
-    return false;
+static inline void copy_view(char *buff, const char *uri,
+        const struct hvml_uri_view *view)
+{
+    memcpy(buff, uri + view->off, view->len);
+    buff[view->len] = '\0';
 }
 
+static inline char *dup_view(const char *uri, const struct hvml_uri_view *view)
+{
+    return strndup(uri + view->off, view->len);
+}
 
-bool hvml_uri_split_alloc(const char *uri,
-        char **host, char **app, char **runner, char **group, char **page)
+bool hvml_uri_split(const char *uri,
+        char *host, char *app, char *runner, char *group, char *page)
 {
-    static const unsigned int sz_schema = sizeof(HVML_SCHEMA) - 1;
-    char *my_host = NULL, *my_app = NULL, *my_runner = NULL;
-    char *my_group = NULL, *my_page = NULL;
-    unsigned int len;
+    struct hvml_uri_views views;
 
-    if (strncasecmp(uri, HVML_SCHEMA, sz_schema))
+    if (!hvml_uri_split_views(uri, &views))
         return false;
 
-    uri += sz_schema;
-    len = get_path_comp_len(uri);
-    if (len == 0 || uri[len] != COMP_SEPERATOR)
+    /* the caller may not be insterested in group and page */
+    if ((group || page) && views.page.len == 0)
         return false;
-    my_host = strndup(uri, len);
 
-    uri += len + 1;
-    len = get_path_comp_len(uri);
-    if (len == 0 || uri[len] != COMP_SEPERATOR)
-        goto failed;
-    my_app = strndup(uri, len);
+    if (host)
+        copy_view(host, uri, &views.host);
+    if (app)
+        copy_view(app, uri, &views.app);
+    if (runner)
+        copy_view(runner, uri, &views.runner);
+    if (group)
+        copy_view(group, uri, &views.group);
+    if (page)
+        copy_view(page, uri, &views.page);
 
-    uri += len + 1;
-    len = get_path_comp_len(uri);
-    if (len == 0 || uri[len] != COMP_SEPERATOR)
-        goto failed;
-    my_runner = strndup(uri, len);
+    return true;
+}
 
-    if (group == NULL && page == NULL) {
-        /* stop splitting if the caller was not insterested in group and page */
-        goto done;
-    }
+bool hvml_uri_split_alloc(const char *uri,
+        char **host, char **app, char **runner, char **group, char **page)
+{
+    struct hvml_uri_views views;
 
-    uri += len + 1;
-    len = get_path_comp_len(uri);
-    if (len == 0 || uri[len] != COMP_SEPERATOR)
-        goto failed;
-    my_group = strndup(uri, len);
+    if (!hvml_uri_split_views(uri, &views))
+        return false;
 
-    uri += len + 1;
-    len = get_path_trail_len(uri);
-    if (len == 0 || uri[0] == COMP_SEPERATOR)
-        goto failed;
-    my_page = strndup(uri, len);
+    /* the caller may not be insterested in group and page */
+    if ((group || page) && views.page.len == 0)
+        return false;
 
-done:
     if (host)
-        *host = my_host;
-    else
-        free(my_host);
-
+        *host = dup_view(uri, &views.host);
     if (app)
-        *app = my_app;
-    else
-        free(my_app);
-
+        *app = dup_view(uri, &views.app);
     if (runner)
-        *runner = my_runner;
-    else
-        free(my_runner);
-
+        *runner = dup_view(uri, &views.runner);
     if (group)
-        *group = my_group;
-    else if (my_group)
-        free(my_group);
-
+        *group = dup_view(uri, &views.group);
     if (page)
-        *page = my_page;
-    else
-        free(my_page);
+        *page = dup_view(uri, &views.page);
 
     return true;
-
-failed:
-    if (my_host)
-        free(my_host);
-    if (my_app)
-        free(my_app);
-    if (my_runner)
-        free(my_runner);
-    if (my_group)
-        free(my_group);
-    if (my_page)
-        free(my_page);
-
-    return false;
 }
 
 static size_t get_key_len(const char *str)
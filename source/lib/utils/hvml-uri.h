@@ -22,6 +22,22 @@
 #define __LIB_UTILS_HVML_URI_H
 
 #include <stdbool.h>
+#include <stddef.h>
+
+/* A component of an HVML URI: the offset in the URI and the length. */
+struct hvml_uri_view {
+    unsigned int off;
+    unsigned int len;
+};
+
+struct hvml_uri_views {
+    struct hvml_uri_view host;
+    struct hvml_uri_view app;
+    struct hvml_uri_view runner;
+    struct hvml_uri_view group;
+    struct hvml_uri_view page;
+    struct hvml_uri_view query;     /* without the leading `?` */
+};
 
 #ifdef __cplusplus
 extern "C" {
@@ -45,6 +61,14 @@ bool hvml_uri_split(const char *uri,
 bool hvml_uri_split_alloc(const char *uri,
         char **host, char **app, char **runner, char **group, char **page);
 
+/*
+ * Break down an HVML URI in the pattern above without copying anything.
+ * Returns false if the host, the app, or the runner is bad. The length of
+ * the group and the page is 0 if they are bad or missing; the length of the
+ * query is 0 if there is no query or no page.
+ */
+bool hvml_uri_split_views(const char *uri, struct hvml_uri_views *views);
+
 bool hvml_uri_get_query_value(const char *uri, const char *key,
         char *value_buff);
 
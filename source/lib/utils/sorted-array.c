@@ -39,6 +39,10 @@ struct sorted_array {
     /* the number of members */
     size_t                      nr_members;
 
+    /* the number of members appended by sorted_array_append() but
+       not sorted yet; they are at the tail of the array */
+    size_t                      nr_unsorted;
+
     /* the pointer to an array contains the members */
     struct sorted_array_member *members;
 
@@ -62,6 +66,156 @@ def_cmp(uint64_t sortv1, uint64_t sortv2)
     return 0;
 }
 
+static inline int
+sa_cmp(struct sorted_array *sa, uint64_t sortv1, uint64_t sortv2)
+{
+    int cmp = sa->cmp_fn(sortv1, sortv2);
+    return (sa->flags & SAFLAG_ORDER_DESC) ? -cmp : cmp;
+}
+
+/* make sure there is room for `nr_more` new members; grow geometrically */
+static int
+sa_reserve(struct sorted_array *sa, size_t nr_more)
+{
+    size_t nr_needed = sa->nr_members + nr_more;
+
+    if (nr_needed > (SIZE_MAX >> 1) / sizeof(struct sorted_array_member)) {
+        return -2;
+    }
+
+    if (nr_needed > sa->sz_array) {
+        size_t new_sz = sa->sz_array;
+        while (new_sz < nr_needed)
+            new_sz *= 2;
+
+        struct sorted_array_member *new_members;
+        new_members = realloc(sa->members,
+                sizeof(struct sorted_array_member) * new_sz);
+        if (new_members == NULL) {
+            return -3;
+        }
+
+        sa->members = new_members;
+        sa->sz_array = new_sz;
+    }
+
+    return 0;
+}
+
+/*
+ * Search the (sorted) members for the sort value. Returns true and the index
+ * of the found member in `idx`, or false and the index where the new member
+ * should be inserted.
+ */
+static bool
+sa_search(struct sorted_array *sa, uint64_t sortv, size_t *idx)
+{
+    ssize_t low, high, mid;
+
+    low = 0;
+    high = sa->nr_members - 1;
+    while (low <= high) {
+        int cmp;
+
+        mid = (low + high) / 2;
+        cmp = sa_cmp(sa, sortv, sa->members[mid].sortv);
+        if (cmp == 0) {
+            *idx = mid;
+            return true;
+        }
+        else if (cmp < 0) {
+            high = mid - 1;
+        }
+        else {
+            low = mid + 1;
+        }
+    }
+
+    *idx = low;
+    return false;
+}
+
+/* stable bottom-up merge sort of the members */
+static int
+sa_merge_sort(struct sorted_array *sa, struct sorted_array_member *members,
+        size_t nr)
+{
+    struct sorted_array_member *tmp, *src, *dst;
+    size_t width;
+
+    if (nr < 2)
+        return 0;
+
+    tmp = malloc(sizeof(struct sorted_array_member) * nr);
+    if (tmp == NULL)
+        return -3;
+
+    src = members;
+    dst = tmp;
+    for (width = 1; width < nr; width *= 2) {
+        size_t i;
+        for (i = 0; i < nr; i += 2 * width) {
+            size_t left = i;
+            size_t mid = (i + width < nr) ? i + width : nr;
+            size_t right = (i + 2 * width < nr) ? i + 2 * width : nr;
+            size_t l = left, r = mid, k = left;
+
+            while (l < mid && r < right) {
+                if (sa_cmp(sa, src[r].sortv, src[l].sortv) < 0)
+                    dst[k++] = src[r++];
+                else
+                    dst[k++] = src[l++];
+            }
+
+            while (l < mid)
+                dst[k++] = src[l++];
+            while (r < right)
+                dst[k++] = src[r++];
+        }
+
+        struct sorted_array_member *t = src;
+        src = dst;
+        dst = t;
+    }
+
+    if (src != members)
+        memcpy(members, src, sizeof(struct sorted_array_member) * nr);
+
+    free(tmp);
+    return 0;
+}
+
+/* sort the members appended by sorted_array_append() into the array */
+static int
+sa_sort_pending(struct sorted_array *sa)
+{
+    if (sa->nr_unsorted == 0)
+        return 0;
+
+    if (sa_merge_sort(sa, sa->members, sa->nr_members))
+        return -3;
+    sa->nr_unsorted = 0;
+
+    if (!(sa->flags & SAFLAG_DUPLCATE_SORTV) && sa->nr_members > 1) {
+        /* keep the first member of the ones having the same sort value */
+        size_t i, n = 1;
+        for (i = 1; i < sa->nr_members; i++) {
+            if (sa_cmp(sa, sa->members[i].sortv,
+                        sa->members[n - 1].sortv) == 0) {
+                if (sa->free_fn)
+                    sa->free_fn(sa->members[i].sortv, sa->members[i].data);
+            }
+            else {
+                sa->members[n++] = sa->members[i];
+            }
+        }
+
+        sa->nr_members = n;
+    }
+
+    return 0;
+}
+
 struct sorted_array *
 sorted_array_create(unsigned int flags, size_t sz_init,
         sacb_free free_fn, sacb_compare cmp_fn)
@@ -105,71 +259,24 @@ void sorted_array_destroy(struct sorted_array *sa)
 
 int sorted_array_add(struct sorted_array *sa, uint64_t sortv, void *data)
 {
-    ssize_t i, idx;
-    ssize_t low, high, mid;
-
-    if (!(sa->flags & SAFLAG_DUPLCATE_SORTV)) {
-        if (sorted_array_find(sa, sortv, NULL)) {
-            return -1;
-        }
-    }
-
-    if ((sa->nr_members + 1) > (SIZE_MAX >> 1)) {
-        return -2;
-    }
-
-    if ((sa->nr_members + 1) >= sa->sz_array) {
-        size_t new_sz = sa->sz_array + SASZ_DEFAULT;
-        struct sorted_array_member *old_members = sa->members;
-
-        sa->members = realloc(sa->members,
-                sizeof(struct sorted_array_member) * new_sz);
-        if (sa->members == NULL) {
-            sa->members = old_members;
-            return -3;
-        }
-
-        sa->sz_array = new_sz;
-    }
+    size_t idx;
+    int ret;
 
-    low = 0;
-    high = sa->nr_members - 1;
-    while (low <= high) {
-        int cmp;
+    if ((ret = sa_sort_pending(sa)))
+        return ret;
 
-        mid = (low + high) / 2;
-        cmp = sa->cmp_fn(sortv, sa->members[mid].sortv);
-        if (cmp == 0) {
-            break;
-        }
-        else if (sa->flags & SAFLAG_ORDER_DESC) {
-            if (cmp > 0) {
-                high = mid - 1;
-            }
-            else {
-                low = mid + 1;
-            }
-        }
-        else {
-            if (cmp < 0) {
-                high = mid - 1;
-            }
-            else {
-                low = mid + 1;
-            }
+    if (sa_search(sa, sortv, &idx)) {
+        if (!(sa->flags & SAFLAG_DUPLCATE_SORTV)) {
+            return -1;
         }
     }
 
-    if (low <= high) {
-        idx = mid;
-    }
-    else {
-        idx = low;
-    }
+    if ((ret = sa_reserve(sa, 1)))
+        return ret;
 
-    for (i = sa->nr_members; i > idx; i--) {
-        sa->members[i].sortv = sa->members[i - 1].sortv;
-        sa->members[i].data = sa->members[i - 1].data;
+    if (idx < sa->nr_members) {
+        memmove(sa->members + idx + 1, sa->members + idx,
+                sizeof(struct sorted_array_member) * (sa->nr_members - idx));
     }
 
     sa->members[idx].sortv = sortv;
@@ -179,93 +286,90 @@ int sorted_array_add(struct sorted_array *sa, uint64_t sortv, void *data)
     return 0;
 }
 
-bool sorted_array_remove(struct sorted_array *sa, uint64_t sortv)
+int sorted_array_append(struct sorted_array *sa, uint64_t sortv, void *data)
 {
-    ssize_t low, high, mid;
-    size_t i;
+    int ret;
 
-    low = 0;
-    high = sa->nr_members - 1;
-    while (low <= high) {
-        int cmp;
-
-        mid = (low + high) / 2;
-        cmp = sa->cmp_fn(sortv, sa->members[mid].sortv);
-        if (cmp == 0) {
-            goto found;
-        }
-        else if (sa->flags & SAFLAG_ORDER_DESC) {
-            if (cmp > 0) {
-                high = mid - 1;
-            }
-            else {
-                low = mid + 1;
-            }
-        }
-        else {
-            if (cmp < 0) {
-                high = mid - 1;
-            }
-            else {
-                low = mid + 1;
-            }
-        }
-    }
+    if ((ret = sa_reserve(sa, 1)))
+        return ret;
 
-    return false;
+    sa->members[sa->nr_members].sortv = sortv;
+    sa->members[sa->nr_members].data = data;
+    sa->nr_members++;
+    sa->nr_unsorted++;
+    return 0;
+}
 
-found:
-    if (sa->free_fn) {
-        sa->free_fn(sa->members[mid].sortv, sa->members[mid].data);
-    }
+int sorted_array_build(struct sorted_array *sa)
+{
+    return sa_sort_pending(sa);
+}
 
-    sa->nr_members--;
+bool sorted_array_remove(struct sorted_array *sa, uint64_t sortv)
+{
+    size_t idx;
 
-    for (i = mid; i < sa->nr_members; i++) {
-        sa->members[i].sortv = sa->members[i + 1].sortv;
-        sa->members[i].data = sa->members[i + 1].data;
-    }
+    if (sa_sort_pending(sa) || !sa_search(sa, sortv, &idx))
+        return false;
 
+    sorted_array_delete(sa, idx);
     return true;
 }
 
-bool sorted_array_find(struct sorted_array *sa, uint64_t sortv, void **data)
+size_t sorted_array_remove_batch(struct sorted_array *sa,
+        const uint64_t *sortvs, size_t nr_sortvs)
 {
-    ssize_t low, high, mid;
-
-    low = 0;
-    high = sa->nr_members - 1;
-    while (low <= high) {
-        int cmp;
+    size_t i, n, nr_removed = 0;
+    uint8_t *marks;
+
+    if (sa_sort_pending(sa) || sa->nr_members == 0 || nr_sortvs == 0)
+        return 0;
+
+    marks = calloc(sa->nr_members, sizeof(uint8_t));
+    if (marks == NULL) {
+        /* fall back to remove the members one by one */
+        for (i = 0; i < nr_sortvs; i++) {
+            if (sorted_array_remove(sa, sortvs[i]))
+                nr_removed++;
+        }
+        return nr_removed;
+    }
 
-        mid = (low + high) / 2;
-        cmp = sa->cmp_fn(sortv, sa->members[mid].sortv);
-        if (cmp == 0) {
-            goto found;
+    for (i = 0; i < nr_sortvs; i++) {
+        size_t idx;
+        if (sa_search(sa, sortvs[i], &idx) && !marks[idx]) {
+            marks[idx] = 1;
+            nr_removed++;
         }
-        else if (sa->flags & SAFLAG_ORDER_DESC) {
-            if (cmp > 0) {
-                high = mid - 1;
-            }
-            else {
-                low = mid + 1;
-            }
+    }
+
+    /* compact the array in one pass */
+    for (i = 0, n = 0; i < sa->nr_members; i++) {
+        if (marks[i]) {
+            if (sa->free_fn)
+                sa->free_fn(sa->members[i].sortv, sa->members[i].data);
         }
         else {
-            if (cmp < 0) {
-                high = mid - 1;
-            }
-            else {
-                low = mid + 1;
-            }
+            if (n != i)
+                sa->members[n] = sa->members[i];
+            n++;
         }
     }
 
-    return false;
+    sa->nr_members = n;
+    free(marks);
+    return nr_removed;
+}
+
+bool sorted_array_find(struct sorted_array *sa, uint64_t sortv, void **data)
+{
+    size_t idx;
+
+    if (sa_sort_pending(sa) || !sa_search(sa, sortv, &idx))
+        return false;
 
-found:
     if (data) {
-        *data = sa->members[mid].data;
+        *data = sa->members[idx].data;
     }
 
     return true;
@@ -273,11 +377,14 @@ found:
 
 size_t sorted_array_count(struct sorted_array *sa)
 {
+    /* the appended duplicates are only dropped when sorting */
+    sa_sort_pending(sa);
     return sa->nr_members;
 }
 
 uint64_t sorted_array_get(struct sorted_array *sa, size_t idx, void **data)
 {
+    sa_sort_pending(sa);
     assert (idx < sa->nr_members);
 
     if (data) {
@@ -289,8 +396,7 @@ uint64_t sorted_array_get(struct sorted_array *sa, size_t idx, void **data)
 
 void sorted_array_delete(struct sorted_array *sa, size_t idx)
 {
-    size_t i;
-
+    sa_sort_pending(sa);
     assert (idx < sa->nr_members);
 
     if (sa->free_fn) {
@@ -298,9 +404,8 @@ void sorted_array_delete(struct sorted_array *sa, size_t idx)
     }
 
     sa->nr_members--;
-    for (i = idx; i < sa->nr_members; i++) {
-        sa->members[i].sortv = sa->members[i + 1].sortv;
-        sa->members[i].data = sa->members[i + 1].data;
+    if (idx < sa->nr_members) {
+        memmove(sa->members + idx, sa->members + idx + 1,
+                sizeof(struct sorted_array_member) * (sa->nr_members - idx));
     }
 }
-
@@ -20,6 +20,7 @@
 #ifndef __LIB_UTILS_SORTED_ARRAY_H
 #define __LIB_UTILS_SORTED_ARRAY_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -52,9 +53,22 @@ void sorted_array_destroy(struct sorted_array *sa);
 /* add a new member with the sort value and the data. */
 int sorted_array_add(struct sorted_array *sa, uint64_t sortv, void *data);
 
+/* append a new member without sorting; call sorted_array_build() after
+   appending all members. Unless SAFLAG_DUPLCATE_SORTV is set, only the
+   first one of the members having the same sort value will be kept. */
+int sorted_array_append(struct sorted_array *sa, uint64_t sortv, void *data);
+
+/* sort the members appended by sorted_array_append() in one go. */
+int sorted_array_build(struct sorted_array *sa);
+
 /* remove one member which has the same sort value. */
 bool sorted_array_remove(struct sorted_array *sa, uint64_t sortv);
 
+/* remove the members which have the given sort values in one pass;
+   returns the number of members removed. */
+size_t sorted_array_remove_batch(struct sorted_array *sa,
+        const uint64_t *sortvs, size_t nr_sortvs);
+
 /* find the first member which has the same sort value. */
 bool sorted_array_find(struct sorted_array *sa, uint64_t sortv, void **data);
 